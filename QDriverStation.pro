@@ -87,6 +87,7 @@ SOURCES += \
   $$PWD/src/utilities.cpp \
   $$PWD/src/beeper.cpp \
   $$PWD/src/dashboards.cpp \
+  $$PWD/src/joysticks.cpp \
   $$PWD/src/shortcuts.cpp
   
 HEADERS += \
@@ -94,6 +95,7 @@ HEADERS += \
   $$PWD/src/beeper.h \
   $$PWD/src/dashboards.h \
   $$PWD/src/versions.h \
+  $$PWD/src/joysticks.h \
   $$PWD/src/shortcuts.h
     
 RESOURCES += \
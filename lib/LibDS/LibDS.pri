@@ -13,15 +13,19 @@ HEADERS += \
     $$PWD/include/DS_Config.h \
     $$PWD/include/DS_Events.h \
     $$PWD/include/DS_Joysticks.h \
+    $$PWD/include/DS_Links.h \
     $$PWD/include/DS_Types.h \
     $$PWD/include/DS_Utils.h \
     $$PWD/include/LibDS.h \
     $$PWD/include/DS_Array.h \
+    $$PWD/include/DS_Atomic.h \
+    $$PWD/include/DS_Buffer.h \
     $$PWD/include/DS_Socket.h \
     $$PWD/include/DS_Protocol.h \
     $$PWD/include/DS_DefaultProtocols.h \
     $$PWD/include/DS_Timer.h \
     $$PWD/include/DS_Queue.h \
+    $$PWD/include/DS_Resolver.h \
     $$PWD/include/DS_String.h
 
 SOURCES += \
@@ -33,13 +37,16 @@ SOURCES += \
     $$PWD/src/events.c \
     $$PWD/src/init.c \
     $$PWD/src/joysticks.c \
+    $$PWD/src/links.c \
     $$PWD/src/protocols.c \
     $$PWD/src/socket.c \
     $$PWD/src/utils.c \
     $$PWD/src/crc32.c \
     $$PWD/src/array.c \
+    $$PWD/src/buffer.c \
     $$PWD/src/timer.c \
     $$PWD/src/queue.c \
+    $$PWD/src/resolver.c \
     $$PWD/src/string.c
     
 include ($$PWD/lib/Socky/Socky.pri)
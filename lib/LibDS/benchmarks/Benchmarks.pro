@@ -0,0 +1,20 @@
+TEMPLATE = app
+TARGET = LibDS_Benchmarks
+
+CONFIG += console
+CONFIG -= qt
+CONFIG -= app_bundle
+
+include ($$PWD/../LibDS.pri)
+
+#-------------------------------------------------------------------------------
+# Count the allocations made by the LibDS (GNU ld only)
+#-------------------------------------------------------------------------------
+
+linux-g++*|linux-clang* {
+    DEFINES += COUNT_ALLOCATIONS
+    QMAKE_LFLAGS += -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+}
+
+SOURCES += \
+    $$PWD/main.c
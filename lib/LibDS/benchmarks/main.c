@@ -0,0 +1,304 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Measures the time (and the number of heap allocations) used by the hot
+ * paths of the LibDS: packet generation, packet interpretation, string
+ * operations and checksums.
+ *
+ * The results are written to the standard output in CSV format, with the
+ * following columns: benchmark, iterations, ns/op and allocs/op. The allocs/op
+ * column is set to -1 when allocation counting is not supported.
+ */
+
+#include "LibDS.h"
+#include "DS_Atomic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_BENCH_TIME  200000 /* Minimum time of each benchmark (in usecs) */
+#define MAX_JOYSTICKS   6      /* Benchmark packets with 0 to 6 joysticks */
+#define CRC_BLOCK_SIZE  1024   /* Size of the data block used by DS_CRC32 */
+#define AXIS_COUNT      192    /* Number of axes encoded by DS_FloatsToBytes */
+
+/*
+ * Allocation counters, GNU ld redirects the allocations made by the LibDS
+ * (which is compiled into this program) to the wrappers below
+ */
+#if defined COUNT_ALLOCATIONS
+static long allocations = 0;
+
+extern void* __real_malloc (size_t size);
+extern void* __real_calloc (size_t count, size_t size);
+extern void* __real_realloc (void* ptr, size_t size);
+
+void* __wrap_malloc (size_t size)
+{
+    DS_AtomicAdd (&allocations, 1);
+    return __real_malloc (size);
+}
+
+void* __wrap_calloc (size_t count, size_t size)
+{
+    DS_AtomicAdd (&allocations, 1);
+    return __real_calloc (count, size);
+}
+
+void* __wrap_realloc (void* ptr, size_t size)
+{
+    DS_AtomicAdd (&allocations, 1);
+    return __real_realloc (ptr, size);
+}
+#endif
+
+/*
+ * Data used by the benchmarked functions
+ */
+static DS_String string;
+static DS_Protocol* protocol;
+static DS_String robot_packet;
+static float axes [AXIS_COUNT];
+static uint8_t axis_bytes [AXIS_COUNT];
+static uint8_t crc_block [CRC_BLOCK_SIZE];
+static uint8_t packet_storage [DS_SOCKET_BUFFER_SIZE];
+
+/**
+ * Returns the number of allocations made since the program started
+ */
+static long get_allocations (void)
+{
+#if defined COUNT_ALLOCATIONS
+    return DS_AtomicLoad (&allocations);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Runs the given \a function until it has been running for at least
+ * \c MIN_BENCH_TIME microseconds and prints the results as a CSV row
+ */
+static void run (const char* name, void (*function) (void))
+{
+    long i;
+    long iterations = 1;
+
+    /* Warm up caches and lazy initializations */
+    function();
+
+    /* Double the number of iterations until the benchmark is long enough */
+    while (1) {
+        long allocs = get_allocations();
+        uint64_t start = DS_GetTimestamp();
+
+        for (i = 0; i < iterations; ++i)
+            function();
+
+        uint64_t elapsed = DS_GetTimestamp() - start;
+        allocs = get_allocations() - allocs;
+
+        if (elapsed >= MIN_BENCH_TIME) {
+            double ns = (double) elapsed * 1000 / iterations;
+#if defined COUNT_ALLOCATIONS
+            double allocs_per_op = (double) allocs / iterations;
+#else
+            double allocs_per_op = -1;
+            (void) allocs;
+#endif
+            printf ("%s,%ld,%.2f,%.2f\n", name, iterations, ns, allocs_per_op);
+            fflush (stdout);
+            return;
+        }
+
+        iterations *= 2;
+    }
+}
+
+/**
+ * Generates a robot packet with the current protocol (and deletes it)
+ */
+static void bench_create_robot_packet (void)
+{
+    DS_String packet = protocol->create_robot_packet();
+    DS_StrRmBuf (&packet);
+}
+
+/**
+ * Writes a robot packet into a pre-allocated buffer with the current protocol
+ */
+static void bench_build_robot_packet (void)
+{
+    DS_Buffer buffer;
+    DS_BufferInit (&buffer, packet_storage, sizeof (packet_storage));
+    protocol->build_robot_packet (&buffer);
+}
+
+/**
+ * Interprets a robot packet with the current protocol
+ */
+static void bench_read_robot_packet (void)
+{
+    protocol->read_robot_packet (&robot_packet);
+}
+
+/**
+ * Appends 256 bytes to a string, one byte at a time
+ */
+static void bench_string_append (void)
+{
+    int i;
+    DS_String str = DS_StrNewLen (0);
+    for (i = 0; i < 256; ++i)
+        DS_StrAppend (&str, (uint8_t) i);
+
+    DS_StrRmBuf (&str);
+}
+
+/**
+ * Joins a 64-byte string to another string 16 times
+ */
+static void bench_string_join (void)
+{
+    int i;
+    DS_String str = DS_StrNewLen (0);
+    for (i = 0; i < 16; ++i)
+        DS_StrJoin (&str, &string);
+
+    DS_StrRmBuf (&str);
+}
+
+/**
+ * Calculates the checksum of a 1024-byte block
+ */
+static void bench_crc32 (void)
+{
+    volatile uint32_t crc = DS_CRC32 (crc_block, sizeof (crc_block));
+    (void) crc;
+}
+
+/**
+ * Encodes 192 axis values (6 joysticks with 32 axes each)
+ */
+static void bench_floats_to_bytes (void)
+{
+    DS_FloatsToBytes (axes, axis_bytes, AXIS_COUNT, 1);
+}
+
+/**
+ * Registers the given number of joysticks and moves their axes and buttons
+ */
+static void set_joysticks (const int count)
+{
+    int i;
+    DS_JoysticksReset();
+
+    for (i = 0; i < count; ++i) {
+        DS_JoysticksAdd (6, 1, 12);
+        DS_SetJoystickHat (i, 0, 90);
+        DS_SetJoystickAxis (i, 0, 0.5);
+        DS_SetJoystickAxis (i, 1, -0.75);
+        DS_SetJoystickButton (i, 0, 1);
+        DS_SetJoystickButton (i, 5, 1);
+    }
+}
+
+/**
+ * Runs the packet benchmarks with the given protocol \a name and a robot
+ * \a packet of the given \a length
+ */
+static void bench_protocol (const char* name, DS_Protocol* ptr,
+                            const char* packet, const int length)
+{
+    int i;
+    char label [64];
+
+    /* Set the protocol and the robot packet */
+    protocol = ptr;
+    robot_packet = DS_StrNewLen (length);
+    memcpy (robot_packet.buf, packet, length);
+
+    /* Generate robot packets with 0 to MAX_JOYSTICKS joysticks */
+    for (i = 0; i <= MAX_JOYSTICKS; ++i) {
+        set_joysticks (i);
+
+        snprintf (label, sizeof (label), "%s/create_robot_packet/%d", name, i);
+        run (label, &bench_create_robot_packet);
+
+        snprintf (label, sizeof (label), "%s/build_robot_packet/%d", name, i);
+        run (label, &bench_build_robot_packet);
+    }
+
+    /* Interpret robot packets */
+    snprintf (label, sizeof (label), "%s/read_robot_packet", name);
+    run (label, &bench_read_robot_packet);
+
+    /* Clean up */
+    set_joysticks (0);
+    DS_StrRmBuf (&robot_packet);
+    DS_StrRmBuf (&ptr->name);
+}
+
+int main (void)
+{
+    int i;
+
+    /* Robot packets, 2014 packets are 1024 bytes long */
+    char packet_2014 [1024];
+    char packet_2015 [8] = { 0x00, 0x01, 0x01, 0x00, 0x30, 0x0c, 0x80, 0x00 };
+    memset (packet_2014, 0, sizeof (packet_2014));
+    packet_2014 [1] = 0x12;
+    packet_2014 [2] = 0x80;
+
+    /* Protocols */
+    DS_Protocol frc_2014 = DS_GetProtocolFRC_2014();
+    DS_Protocol frc_2015 = DS_GetProtocolFRC_2015();
+    DS_Protocol frc_2016 = DS_GetProtocolFRC_2016();
+
+    /* Initialize the data used by the string and checksum benchmarks */
+    string = DS_StrNewLen (64);
+    for (i = 0; i < (int) sizeof (crc_block); ++i)
+        crc_block [i] = (uint8_t) (i * 31);
+    for (i = 0; i < AXIS_COUNT; ++i)
+        axes [i] = (float) ((i % 21) - 10) / 10;
+
+    /* Initialize the LibDS, but do not load any protocol */
+    DS_Init();
+
+    /* Run the benchmarks */
+    printf ("benchmark,iterations,ns_per_op,allocs_per_op\n");
+    bench_protocol ("frc_2014", &frc_2014, packet_2014, sizeof (packet_2014));
+    bench_protocol ("frc_2015", &frc_2015, packet_2015, sizeof (packet_2015));
+    bench_protocol ("frc_2016", &frc_2016, packet_2015, sizeof (packet_2015));
+    run ("string/append_256", &bench_string_append);
+    run ("string/join_16x64", &bench_string_join);
+    run ("crc32/1024", &bench_crc32);
+    run ("utils/floats_to_bytes_192", &bench_floats_to_bytes);
+
+    /* Clean up */
+    DS_StrRmBuf (&string);
+    DS_Close();
+
+    return EXIT_SUCCESS;
+}
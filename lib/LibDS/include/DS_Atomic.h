@@ -0,0 +1,60 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_ATOMIC_H
+#define _LIB_DS_ATOMIC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Minimal set of atomic operations used by the lock-free parts of the library.
+ * The operations work on (unsigned) long values, loads have acquire semantics,
+ * stores have release semantics and read-modify-write operations are full
+ * barriers. MSVC does not support C11 atomics, so we use its intrinsics there.
+ */
+#if defined _MSC_VER
+    #include <windows.h>
+    #define DS_AtomicLoad(ptr)        InterlockedCompareExchange ((volatile LONG*) (ptr), 0, 0)
+    #define DS_AtomicStore(ptr,val)   InterlockedExchange ((volatile LONG*) (ptr), (LONG) (val))
+    #define DS_AtomicAdd(ptr,val)     InterlockedExchangeAdd ((volatile LONG*) (ptr), (LONG) (val))
+    #define DS_AtomicOr(ptr,val)      InterlockedOr ((volatile LONG*) (ptr), (LONG) (val))
+    #define DS_AtomicExchange(ptr,val) InterlockedExchange ((volatile LONG*) (ptr), (LONG) (val))
+    #define DS_AtomicCAS(ptr,old,val) (InterlockedCompareExchange ((volatile LONG*) (ptr), (LONG) (val), (LONG) (old)) == (LONG) (old))
+    #define DS_AtomicFence()          MemoryBarrier()
+#else
+    #define DS_AtomicLoad(ptr)        __atomic_load_n ((ptr), __ATOMIC_ACQUIRE)
+    #define DS_AtomicStore(ptr,val)   __atomic_store_n ((ptr), (val), __ATOMIC_RELEASE)
+    #define DS_AtomicAdd(ptr,val)     __atomic_fetch_add ((ptr), (val), __ATOMIC_ACQ_REL)
+    #define DS_AtomicOr(ptr,val)      __atomic_fetch_or ((ptr), (val), __ATOMIC_ACQ_REL)
+    #define DS_AtomicExchange(ptr,val) __atomic_exchange_n ((ptr), (val), __ATOMIC_ACQ_REL)
+    #define DS_AtomicCAS(ptr,old,val) __sync_bool_compare_and_swap ((ptr), (old), (val))
+    #define DS_AtomicFence()          __atomic_thread_fence (__ATOMIC_SEQ_CST)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
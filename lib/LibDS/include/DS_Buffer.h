@@ -0,0 +1,61 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_BUFFER_H
+#define _LIB_DS_BUFFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "DS_String.h"
+
+/**
+ * Writes bytes into a fixed-size memory block provided by the caller. The
+ * buffer never allocates memory, writes that do not fit are rejected and
+ * recorded in the \c overflow flag.
+ */
+typedef struct {
+    uint8_t* data;  /**< Memory block provided by the caller */
+    size_t size;    /**< Capacity of the memory block */
+    size_t len;     /**< Number of bytes written */
+    int overflow;   /**< Set to \c 1 if a write did not fit in the buffer */
+} DS_Buffer;
+
+extern void DS_BufferInit (DS_Buffer* buffer, void* data, const size_t size);
+
+extern int DS_BufferAppend (DS_Buffer* buffer, const uint8_t byte);
+extern int DS_BufferResize (DS_Buffer* buffer, const size_t len);
+extern int DS_BufferSetByte (DS_Buffer* buffer, const size_t pos, const uint8_t byte);
+extern int DS_BufferAppendBytes (DS_Buffer* buffer, const void* data, const size_t len);
+
+extern DS_String DS_BufferToString (const DS_Buffer* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
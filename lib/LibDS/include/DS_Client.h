@@ -53,6 +53,7 @@ extern char* DS_GetAppliedRobotAddress (void);
 extern char* DS_GetStatusString (void);
 
 /* Getters */
+extern void DS_GetState (DS_State* state);
 extern int DS_GetTeamNumber (void);
 extern int DS_GetRobotCode (void);
 extern int DS_GetCanBeEnabled (void);
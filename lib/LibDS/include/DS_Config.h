@@ -46,7 +46,20 @@ extern "C" {
 #define RECONFIGURE_ROBOT 0x04
 #define RECONFIGURE_ALL   0x01 | 0x02 | 0x04
 
+/*
+ * Flags that tell the protocols which parts of their packets must be
+ * re-generated (see CFG_TakeDirtyFlags())
+ */
+#define CFG_DIRTY_CONTROL 0x01
+#define CFG_DIRTY_REQUEST 0x02
+#define CFG_DIRTY_STATION 0x04
+#define CFG_DIRTY_ALL     0x01 | 0x02 | 0x04
+
 /* Misc */
+extern void CFG_EndUpdate (void);
+extern void CFG_BeginUpdate (void);
+extern int CFG_TakeDirtyFlags (void);
+extern void CFG_GetState (DS_State* state);
 extern void CFG_ReconfigureAddresses (const int flags);
 
 /* NetConsole ouput */
@@ -117,8 +117,20 @@ typedef union {
     DS_NetConsoleEvent netconsole;
 } DS_Event;
 
+/**
+ * \brief What to do with new events when the event queue is full
+ */
+typedef enum {
+    DS_EVENTS_COALESCE          = 0x00,
+    DS_EVENTS_DROP_OLDEST       = 0x01,
+} DS_EventOverflowPolicy;
+
 extern void Events_Init (void);
 extern void Events_Close (void);
+extern unsigned long DS_DroppedEvents (void);
+extern void DS_SetEventCoalescing (const int enabled);
+extern unsigned long DS_MergedEvents (const DS_EventType type);
+extern void DS_SetEventOverflowPolicy (const DS_EventOverflowPolicy policy);
 extern void DS_AddEvent (DS_Event* event);
 extern int DS_PollEvent (DS_Event* event);
 
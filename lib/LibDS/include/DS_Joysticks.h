@@ -28,10 +28,45 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
+/*
+ * Capacity of the joystick store, extra joysticks are rejected and extra
+ * axes, hats and buttons are ignored
+ */
+#define DS_MAX_JOYSTICKS        16
+#define DS_MAX_JOYSTICK_AXES    32
+#define DS_MAX_JOYSTICK_HATS    8
+#define DS_MAX_JOYSTICK_BUTTONS 64
+
+/**
+ * Holds the layout and values of every registered joystick in contiguous
+ * arrays. Values of unused joysticks, axes, hats and buttons are \c 0.
+ */
+typedef struct _joystick_snapshot {
+    int count;                                /**< Number of joysticks */
+    int num_axes [DS_MAX_JOYSTICKS];          /**< Axis count of each joystick */
+    int num_hats [DS_MAX_JOYSTICKS];          /**< Hat count of each joystick */
+    int num_buttons [DS_MAX_JOYSTICKS];       /**< Button count of each joystick */
+    uint64_t buttons [DS_MAX_JOYSTICKS];      /**< Button states, bit \c n is button \c n */
+    int16_t hats [DS_MAX_JOYSTICKS][DS_MAX_JOYSTICK_HATS];  /**< Hat angles */
+    float axes [DS_MAX_JOYSTICKS][DS_MAX_JOYSTICK_AXES];    /**< Axis values */
+} DS_JoystickSnapshot;
+
 extern void Joysticks_Init (void);
 extern void Joysticks_Close (void);
+extern uint64_t Joysticks_TakeInputTime (void);
+extern void Joysticks_InputSent (const uint64_t input_time);
+
+/*
+ * Changes reported by DS_TakeJoystickDirtyFlags(), joysticks past the 32nd
+ * share the last bit
+ */
+#define DS_JOYSTICK_DIRTY(flags,joystick) \
+    (((flags) >> ((joystick) < 31 ? (joystick) : 31)) & 1)
 
 extern int DS_GetJoystickCount (void);
+extern unsigned long DS_TakeJoystickDirtyFlags (void);
 extern int DS_GetJoystickNumHats (int joystick);
 extern int DS_GetJoystickNumAxes (int joystick);
 extern int DS_GetJoystickNumButtons (int joystick);
@@ -39,6 +74,7 @@ extern int DS_GetJoystickNumButtons (int joystick);
 extern int DS_GetJoystickHat (int joystick, int hat);
 extern float DS_GetJoystickAxis (int joystick, int axis);
 extern int DS_GetJoystickButton (int joystick, int button);
+extern void DS_GetJoystickSnapshot (DS_JoystickSnapshot* snapshot);
 
 extern void DS_JoysticksReset (void);
 extern void DS_JoysticksAdd (const int axes, const int hats, const int buttons);
@@ -46,6 +82,11 @@ extern void DS_SetJoystickHat (int joystick, int hat, int angle);
 extern void DS_SetJoystickAxis (int joystick, int axis, float value);
 extern void DS_SetJoystickButton (int joystick, int button, int pressed);
 
+extern void DS_ResetInputLatency (void);
+extern float DS_GetInputLatency (void);
+extern float DS_GetMaxInputLatency (void);
+extern float DS_GetAverageInputLatency (void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,58 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_LINKS_H
+#define _LIB_DS_LINKS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "DS_Types.h"
+
+/**
+ * Number of buckets in the latency histogram of each link
+ */
+#define DS_LATENCY_BUCKETS 384
+
+/* Init/Close functions */
+extern void Links_Init (void);
+extern void Links_Close (void);
+
+/* Called by the protocol module */
+extern void Links_PacketSent (const DS_Link link, const int sequence);
+extern void Links_PacketReceived (const DS_Link link, const int sequence);
+extern void Links_PacketsDropped (const DS_Link link, const unsigned long count);
+
+/* Statistics */
+extern void DS_ResetLinkStats (const DS_Link link);
+extern void DS_GetLinkStats (const DS_Link link, DS_LinkStats* stats);
+extern float DS_GetLatencyPercentile (const DS_Link link, const float percentile);
+extern int DS_GetLatencyHistogram (const DS_Link link, unsigned long* counts, const int size);
+extern float DS_GetLatencyBucketLimit (const int bucket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,6 +28,7 @@
 extern "C" {
 #endif
 
+#include "DS_Buffer.h"
 #include "DS_Socket.h"
 #include "DS_String.h"
 
@@ -37,14 +38,27 @@ typedef struct _protocol {
     DS_String (*radio_address) (void);
     DS_String (*robot_address) (void);
 
+    /* Optional, write other robot addresses to probe and return their count */
+    int (*robot_candidates) (DS_String* addresses, const int max);
+
     DS_String (*create_fms_packet) (void);
     DS_String (*create_radio_packet) (void);
     DS_String (*create_robot_packet) (void);
 
+    /* Optional, write the packet into a caller-provided buffer (or NULL) */
+    int (*build_fms_packet) (DS_Buffer*);
+    int (*build_radio_packet) (DS_Buffer*);
+    int (*build_robot_packet) (DS_Buffer*);
+
     int (*read_fms_packet) (const DS_String*);
     int (*read_radio_packet) (const DS_String*);
     int (*read_robot_packet) (const DS_String*);
 
+    /* Optional, return the sequence number of a sent/received packet or -1 */
+    int (*fms_sequence) (const uint8_t*, const size_t, const int sent);
+    int (*radio_sequence) (const uint8_t*, const size_t, const int sent);
+    int (*robot_sequence) (const uint8_t*, const size_t, const int sent);
+
     void (*reset_fms) (void);
     void (*reset_radio) (void);
     void (*reset_robot) (void);
@@ -0,0 +1,55 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIB_DS_RESOLVER_H
+#define _LIB_DS_RESOLVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Called when a lookup finishes, \a addr points to a \c sockaddr_storage
+ * structure with the address, and \a addr_len is set to \c 0 on failure
+ */
+typedef void (*DS_ResolverCallback) (void* data,
+                                     const int generation,
+                                     const int index,
+                                     const void* addr,
+                                     const int addr_len);
+
+extern void Resolver_Init (void);
+extern void Resolver_Close (void);
+extern void DS_ResolverInvalidate (const char* host);
+extern void DS_ResolverLookup (const char* host,
+                               const char* service,
+                               DS_ResolverCallback callback,
+                               void* data,
+                               const int generation,
+                               const int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,6 +33,27 @@ extern "C" {
 #include "DS_Types.h"
 #include "DS_String.h"
 
+#define DS_SOCKET_QUEUE_SIZE  16   /* Max. number of datagrams waiting to be read */
+#define DS_SOCKET_BUFFER_SIZE 4096 /* Max. size of a received datagram */
+#define DS_SOCKET_ADDR_SIZE   128  /* Size of a struct sockaddr_storage */
+#define DS_SOCKET_CANDIDATES  4    /* Max. number of addresses probed at once */
+
+/**
+ * Holds a resolved network address (a \c struct \c sockaddr_storage)
+ */
+typedef struct {
+    int len;                                /**< Length of the address, 0 if unset */
+    unsigned char data [DS_SOCKET_ADDR_SIZE]; /**< Address data */
+} DS_SocketAddress;
+
+/**
+ * Holds a single datagram received by a socket
+ */
+typedef struct {
+    int size;                           /**< Number of received bytes */
+    char data [DS_SOCKET_BUFFER_SIZE];  /**< Received data */
+} DS_Datagram;
+
 /**
  * Holds all the private (erm, dirty) variables that the sockets module needs
  * to operate with the data provided by a \c DS_Socket structure
@@ -42,8 +63,19 @@ typedef struct {
     int sock_out;          /**< Output socket file descriptor */
     int client_init;       /**< 1 if client is working, 0 if not */
     int server_init;       /**< 1 if server is working, 0 if not */
-    size_t buffer_size;    /**< Holds the number of received bytes */
-    char buffer [4096];    /**< Holds the received data buffer */
+    int connected;         /**< 1 if the UDP client is connected to the remote host */
+    int generation;        /**< Changes every time that the addresses change */
+    int candidate_count;   /**< Number of addresses that are being probed */
+    int lookup_count;      /**< Number of addresses of the current generation */
+    int stale;             /**< 1 if the addresses belong to the previous generation */
+    DS_SocketAddress remote; /**< Address used to send data */
+    DS_SocketAddress candidates [DS_SOCKET_CANDIDATES]; /**< Resolved candidates */
+    int queue_head;        /**< Index of the oldest datagram in the queue */
+    int queue_count;       /**< Number of datagrams waiting to be read */
+    int borrowed;          /**< 1 if the reader holds a view of the oldest datagram */
+    unsigned long dropped; /**< Datagrams lost because the queue was full */
+    DS_Datagram* queue;    /**< Ring buffer with the received datagrams */
+    DS_Datagram* retired;  /**< Queue closed while the reader held a view */
     char in_service [12];  /**< Holds the input port number as a string */
     char out_service [12]; /**< Holds the output port number as a string */
 } DS_SocketInfo;
@@ -62,12 +94,19 @@ typedef struct {
     DS_SocketInfo info;    /**< Ugly data about the socket */
 } DS_Socket;
 
+/**
+ * Called when a datagram queued with \c DS_SocketQueueBytes() is sent, the
+ * \a bytes argument is the number of bytes sent, or \c -1 on failure
+ */
+typedef void (*DS_SocketSentCallback) (void* data, const int bytes);
+
 /* For socket initialization */
 extern DS_Socket* DS_SocketEmpty (void);
 
 /* Module functions */
 extern void Sockets_Init (void);
 extern void Sockets_Close (void);
+extern void DS_SocketSetReadyCallback (void (*callback) (void));
 
 /* Socket initializer and destructor functions */
 extern void DS_SocketOpen (DS_Socket* ptr);
@@ -75,8 +114,17 @@ extern void DS_SocketClose (DS_Socket* ptr);
 
 /* I/O functions */
 extern DS_String DS_SocketRead (DS_Socket* ptr);
+extern int DS_SocketReadView (DS_Socket* ptr, DS_String* view);
+extern unsigned long DS_SocketTakeDropped (DS_Socket* ptr);
 extern int DS_SocketSend (const DS_Socket* ptr, const DS_String* data);
+extern int DS_SocketSendBytes (const DS_Socket* ptr, const void* data, const int len);
+extern void DS_SocketBatchBegin (void);
+extern void DS_SocketBatchFlush (void);
+extern void DS_SocketQueueBytes (const DS_Socket* ptr, const void* data,
+                                 const int len, DS_SocketSentCallback callback,
+                                 void* callback_data);
 extern void DS_SocketChangeAddress (DS_Socket* ptr, const char* address);
+extern void DS_SocketChangeAddresses (DS_Socket* ptr, const char** addresses, const int count);
 
 #ifdef __cplusplus
 }
@@ -28,6 +28,7 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include <pthread.h>
 
 /**
@@ -38,16 +39,21 @@ typedef struct _timer {
     int expired;      /**< Set to \c 1 if \a elapsed is greater than \a time */
     int enabled;      /**< Enabled state of the timer */
     int elapsed;      /**< Number of milliseconds elapsed since last reset */
-    int precision;    /**< The update interval (in milliseconds) */
+    int precision;    /**< Kept for compatibility, deadlines are exact */
     int initialized;  /**< Set to \c 1 if the timer has been initialized */
+    int queue_pos;    /**< Position in the scheduler queue, \c -1 if idle */
+    uint64_t start;   /**< Monotonic time (in usecs) of the last start/reset */
+    void (*callback) (void); /**< Called when the timer expires (optional) */
 } DS_Timer;
 
 extern void Timers_Init (void);
 extern void Timers_Close (void);
 extern void DS_Sleep (const int millisecs);
+extern uint64_t DS_GetTimestamp (void);
 extern void DS_TimerStop (DS_Timer* timer);
 extern void DS_TimerStart (DS_Timer* timer);
 extern void DS_TimerReset (DS_Timer* timer);
+extern void DS_TimerAdvance (DS_Timer* timer);
 extern void DS_TimerInit (DS_Timer* timer, const int time, const int precision);
 
 #ifdef __cplusplus
@@ -45,6 +45,59 @@ typedef enum {
     DS_POSITION_3,
 } DS_Position;
 
+/**
+ * Holds a consistent copy of the robot and client state (see DS_GetState())
+ */
+typedef struct {
+    int team;                 /**< The team number */
+    int robot_code;           /**< Set to \c 1 if the robot code is running */
+    int robot_enabled;        /**< Set to \c 1 if the robot is enabled */
+    int cpu_usage;            /**< CPU usage of the robot (0 to 100) */
+    int ram_usage;            /**< RAM usage of the robot (0 to 100) */
+    int disk_usage;           /**< Disk usage of the robot (0 to 100) */
+    int can_utilization;      /**< CAN utilization of the robot */
+    float robot_voltage;      /**< Voltage of the robot battery */
+    int emergency_stopped;    /**< Set to \c 1 if the robot is e-stopped */
+    int fms_communications;   /**< Set to \c 1 if the FMS is connected */
+    int radio_communications; /**< Set to \c 1 if the radio is connected */
+    int robot_communications; /**< Set to \c 1 if the robot is connected */
+    DS_Position position;     /**< Team station position */
+    DS_Alliance alliance;     /**< Team station alliance */
+    DS_ControlMode control_mode; /**< Control mode of the robot */
+} DS_State;
+
+/**
+ * Identifies the network links managed by the protocol module
+ */
+typedef enum {
+    DS_LINK_FMS,
+    DS_LINK_RADIO,
+    DS_LINK_ROBOT,
+} DS_Link;
+
+/**
+ * Holds the latency and packet loss statistics of a network link
+ * (see DS_GetLinkStats()), all times are given in milliseconds
+ */
+typedef struct {
+    unsigned long samples;      /**< Replies matched to a sent packet */
+    unsigned long unmatched;    /**< Replies that matched no recent packet */
+    unsigned long out_of_order; /**< Packets received after a newer packet */
+    unsigned long duplicates;   /**< Packets received more than once */
+    unsigned long dropped;      /**< Packets discarded before they were read */
+    float min_rtt;              /**< Lowest round-trip time */
+    float max_rtt;              /**< Highest round-trip time */
+    float mean_rtt;             /**< Average round-trip time */
+    float p50_rtt;              /**< Median round-trip time */
+    float p95_rtt;              /**< 95th percentile of the round-trip time */
+    float p99_rtt;              /**< 99th percentile of the round-trip time */
+    float jitter;               /**< Smoothed packet delay variation */
+    unsigned long lost;         /**< Packets lost since the last reset */
+    float loss_1s;              /**< Packet loss (in %) in the last second */
+    float loss_10s;             /**< Packet loss (in %) in the last 10 seconds */
+    float loss_total;           /**< Packet loss (in %) since the last reset */
+} DS_LinkStats;
+
 typedef enum {
     DS_SOCKET_UDP,
     DS_SOCKET_TCP,
@@ -54,8 +54,11 @@ typedef enum {
 /*
  * Misc functions
  */
+extern void CRC32_Init (void);
 extern uint32_t DS_CRC32 (const void* buf, size_t size);
 extern uint8_t DS_FloatToByte (const float val, const float max);
+extern void DS_FloatsToBytes (const float* values, uint8_t* bytes,
+                              const int count, const float max);
 extern DS_String DS_GetStaticIP (const int net, const int team, const int host);
 extern void DS_ShowMessageBox (const DS_String* caption,
                                const DS_String* message,
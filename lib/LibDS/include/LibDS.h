@@ -31,6 +31,7 @@ extern "C" {
 #include "DS_Timer.h"
 #include "DS_Types.h"
 #include "DS_Utils.h"
+#include "DS_Links.h"
 #include "DS_Events.h"
 #include "DS_Client.h"
 #include "DS_Socket.h"
@@ -29,8 +29,10 @@
 #if defined _WIN32
     static WSADATA WSA_DATA;
     #define GET_ERR WSAGetLastError()
+    #define ERR_REFUSED WSAECONNRESET
 #else
     #define GET_ERR errno
+    #define ERR_REFUSED ECONNREFUSED
 #endif
 
 /**
@@ -347,6 +349,81 @@ struct addrinfo* get_address_info (const char* host,
     return info;
 }
 
+/**
+ * Resolves the given \a host and \a service and copies the first address
+ * found into \a addr, so that it can be re-used without calling
+ * \c getaddrinfo() again.
+ *
+ * \param host the host name
+ * \param service the service name or port string
+ * \param socktype the socket type
+ * \param family the address family
+ * \param addr the structure in which to write the address
+ * \param addr_len set to the length of the address
+ *
+ * \returns 0 on success, -1 on failure
+ */
+int resolve_address (const char* host, const char* service,
+                     const int socktype, const int family,
+                     struct sockaddr_storage* addr, socklen_t* addr_len)
+{
+    /* Check arguments */
+    assert (addr);
+    assert (addr_len);
+
+    /* Get address info */
+    struct addrinfo* info = get_address_info (host, service, socktype, family);
+
+    /* Invalid address info */
+    if (info == NULL)
+        return -1;
+
+    /* Copy the first address */
+    memset (addr, 0, sizeof (struct sockaddr_storage));
+    memcpy (addr, info->ai_addr, info->ai_addrlen);
+    *addr_len = (socklen_t) info->ai_addrlen;
+
+    /* Free address information */
+    freeaddrinfo (info);
+    return 0;
+}
+
+/**
+ * Works like \c resolve_address(), but only accepts numeric hosts (e.g.
+ * \c 10.1.2.2), so it never blocks waiting for a name server.
+ *
+ * \returns 0 on success, -1 if the host is not a numeric address
+ */
+int resolve_numeric_address (const char* host, const char* service,
+                             const int socktype, const int family,
+                             struct sockaddr_storage* addr, socklen_t* addr_len)
+{
+    /* Check arguments */
+    assert (addr);
+    assert (addr_len);
+
+    struct addrinfo hints, *info;
+
+    /* Only accept numeric hosts */
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_flags = AI_NUMERICHOST;
+    hints.ai_family = get_family (family);
+    hints.ai_socktype = get_socktype (socktype);
+
+    /* Not a numeric address */
+    if (!host || getaddrinfo (host, service, &hints, &info) != 0)
+        return -1;
+
+    /* Copy the first address */
+    memset (addr, 0, sizeof (struct sockaddr_storage));
+    memcpy (addr, info->ai_addr, info->ai_addrlen);
+    *addr_len = (socklen_t) info->ai_addrlen;
+
+    /* Free address information */
+    freeaddrinfo (info);
+    return 0;
+}
+
 /**
  * Creates a new UDP client socket using the given \a family and \a flags
  *
@@ -567,6 +644,114 @@ int tcp_accept (const int sfd, char* host, const int host_len,
     return client_sfd;
 }
 
+/**
+ * Sets the default destination of the given UDP socket to \a addr, after
+ * this, data can be sent with \c udp_send() without resolving the remote
+ * host again. Calling this function again changes the destination.
+ *
+ * \param sfd the socket file descriptor
+ * \param addr the remote address (e.g. obtained with \c resolve_address())
+ * \param addr_len the length of the remote address
+ *
+ * \returns 0 on success, -1 on failure
+ */
+int udp_connect (const int sfd, const struct sockaddr_storage* addr,
+                 const socklen_t addr_len)
+{
+    /* Check if socket and address are valid */
+    if (!valid_sfd (sfd) || addr == NULL)
+        return -1;
+
+    /* Connect the socket */
+    if (connect (sfd, (const struct sockaddr*) addr, addr_len) != 0) {
+        print_error (sfd, "cannot connect UDP socket", GET_ERR);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Removes the default destination of the given UDP socket, so that it can
+ * send data to any host again
+ *
+ * \param sfd the socket file descriptor
+ *
+ * \returns 0 on success, -1 on failure
+ */
+int udp_disconnect (const int sfd)
+{
+    /* Check if socket is valid */
+    if (!valid_sfd (sfd))
+        return -1;
+
+    /* Connecting to an unspecified address dissolves the association */
+#if defined _WIN32
+    struct sockaddr_in addr;
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+#else
+    struct sockaddr addr;
+    memset (&addr, 0, sizeof (addr));
+    addr.sa_family = AF_UNSPEC;
+#endif
+
+    /* Some systems report an error even if the socket was disconnected */
+    connect (sfd, (struct sockaddr*) &addr, sizeof (addr));
+    return 0;
+}
+
+/**
+ * Sends the given data to the given address, which has been obtained
+ * with \c resolve_address()
+ *
+ * \param sfd the socket descriptor
+ * \param buf the data buffer to send
+ * \param buf_len the length of the data buffer
+ * \param addr the remote address
+ * \param addr_len the length of the remote address
+ * \param flags any additional flags that you may need to use
+ */
+int udp_sendto_addr (const int sfd, const char* buf, const int buf_len,
+                     const struct sockaddr_storage* addr,
+                     const socklen_t addr_len, const int flags)
+{
+    /* Check if socket, buffer and address are valid */
+    if (!valid_sfd (sfd) || buf == NULL || buf_len <= 0 || addr == NULL)
+        return -1;
+
+    /* Send datagram */
+    return sendto (sfd, buf, buf_len, flags,
+                   (const struct sockaddr*) addr, addr_len);
+}
+
+/**
+ * Sends the given data through a UDP socket that has been connected with
+ * \c udp_connect()
+ *
+ * \param sfd the socket descriptor
+ * \param buf the data buffer to send
+ * \param buf_len the length of the data buffer
+ * \param flags any additional flags that you may need to use
+ */
+int udp_send (const int sfd, const char* buf, const int buf_len,
+              const int flags)
+{
+    /* Check if socket and buffer are valid */
+    if (!valid_sfd (sfd) || buf == NULL || buf_len <= 0)
+        return -1;
+
+    /* Send datagram */
+    int bytes = send (sfd, buf, buf_len, flags);
+
+    /* An earlier datagram was refused by the remote host (ICMP port
+     * unreachable), the error is cleared now, so try again */
+    if (bytes < 0 && GET_ERR == ERR_REFUSED)
+        bytes = send (sfd, buf, buf_len, flags);
+
+    return bytes;
+}
+
 /**
  * Re-implements the \c sendto function
  *
@@ -610,35 +795,29 @@ int udp_sendto (const int sfd,
  * \param sfd the socket file descriptor
  * \param buf the data buffer in which to write the data into
  * \param buf_len the length of the data buffer
- * \param host the remote host from which to receive data
- * \param service the local service/port from which to receive data
+ * \param host unused, kept for compatibility
+ * \param service unused, kept for compatibility
  * \param flags any additional flags that you may need to use
+ *
+ * \note The sender address is written to a local structure, so no address
+ *       lookup is needed for each received datagram
  */
 int udp_recvfrom (const int sfd, char* buf, const int buf_len,
                   const char* host, const char* service, const int flags)
 {
+    (void) host;
+    (void) service;
+
     /* Check if socket and buffer length are valid */
     if (!valid_sfd (sfd) || buf_len <= 0)
         return -1;
 
-    /* Get address info */
-    struct addrinfo* info = get_address_info (host, service,
-                                              SOCKY_UDP, SOCKY_ANY);
-
-    /* Invalid address info */
-    if (info == NULL)
-        return -1;
-
     /* Receive remote data */
-#if defined _WIN32
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof (addr);
     int bytes = recvfrom (sfd, buf, buf_len, flags,
-                          info->ai_addr, (int*) &info->ai_addrlen);
-#else
-    int bytes = recvfrom (sfd, buf, buf_len, flags,
-                          info->ai_addr, &info->ai_addrlen);
-#endif
+                          (struct sockaddr*) &addr, &addr_len);
 
     /* Return the number of bytes received */
-    freeaddrinfo (info);
     return bytes;
 }
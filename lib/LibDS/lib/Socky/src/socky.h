@@ -66,6 +66,13 @@ extern int set_socket_block (const int sfd, const int block);
 extern struct addrinfo* get_address_info (const char* host,
                                           const char* service,
                                           int socktype, int family);
+extern int resolve_address (const char* host, const char* service,
+                            const int socktype, const int family,
+                            struct sockaddr_storage* addr, socklen_t* addr_len);
+extern int resolve_numeric_address (const char* host, const char* service,
+                                    const int socktype, const int family,
+                                    struct sockaddr_storage* addr,
+                                    socklen_t* addr_len);
 
 /* Socket initialization functions */
 extern int create_client_udp (const int family, const int flags);
@@ -85,6 +92,16 @@ extern int socket_shutdown (const int sfd, const int method);
 extern int tcp_accept  (const int sfd, char* host, const int host_len,
                         char* service, const int service_len, const int flags);
 
+/* Connected UDP functions */
+extern int udp_connect (const int sfd, const struct sockaddr_storage* addr,
+                        const socklen_t addr_len);
+extern int udp_disconnect (const int sfd);
+extern int udp_send (const int sfd, const char* buf, const int buf_len,
+                     const int flags);
+extern int udp_sendto_addr (const int sfd, const char* buf, const int buf_len,
+                            const struct sockaddr_storage* addr,
+                            const socklen_t addr_len, const int flags);
+
 /* Re-implementation of sendto */
 extern int udp_sendto (const int sfd, const char* buf, const int buf_len,
                        const char* host, const char* service, const int flags);
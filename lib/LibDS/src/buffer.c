@@ -0,0 +1,155 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Buffer.h"
+
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Initializes the given \a buffer to write into the given \a data block,
+ * which must be able to hold \a size bytes
+ */
+void DS_BufferInit (DS_Buffer* buffer, void* data, const size_t size)
+{
+    /* Check arguments */
+    assert (buffer);
+    assert (data || size == 0);
+
+    /* Configure the buffer */
+    buffer->len = 0;
+    buffer->size = size;
+    buffer->overflow = 0;
+    buffer->data = (uint8_t*) data;
+}
+
+/**
+ * Appends the given \a byte to the \a buffer
+ *
+ * \returns \c 1 on success, \c 0 if the buffer is full
+ */
+int DS_BufferAppend (DS_Buffer* buffer, const uint8_t byte)
+{
+    /* Check arguments */
+    assert (buffer);
+
+    /* Buffer is full */
+    if (buffer->len >= buffer->size) {
+        buffer->overflow = 1;
+        return 0;
+    }
+
+    /* Write the byte */
+    buffer->data [buffer->len] = byte;
+    ++buffer->len;
+
+    return 1;
+}
+
+/**
+ * Changes the length of the \a buffer to \a len bytes, any new bytes are
+ * set to \c 0
+ *
+ * \returns \c 1 on success, \c 0 if the buffer cannot hold \a len bytes
+ */
+int DS_BufferResize (DS_Buffer* buffer, const size_t len)
+{
+    /* Check arguments */
+    assert (buffer);
+
+    /* Buffer is too small */
+    if (len > buffer->size) {
+        buffer->overflow = 1;
+        return 0;
+    }
+
+    /* Fill the new bytes with zeroes */
+    if (len > buffer->len)
+        memset (buffer->data + buffer->len, 0, len - buffer->len);
+
+    buffer->len = len;
+    return 1;
+}
+
+/**
+ * Changes the value of the byte at the given \a pos, the position must be
+ * lower than the current length of the \a buffer
+ *
+ * \returns \c 1 on success, \c 0 if \a pos is invalid
+ */
+int DS_BufferSetByte (DS_Buffer* buffer, const size_t pos, const uint8_t byte)
+{
+    /* Check arguments */
+    assert (buffer);
+
+    /* Position is out of range */
+    if (pos >= buffer->len) {
+        buffer->overflow = 1;
+        return 0;
+    }
+
+    buffer->data [pos] = byte;
+    return 1;
+}
+
+/**
+ * Appends \a len bytes from the given \a data to the \a buffer
+ *
+ * \returns \c 1 on success, \c 0 if the data does not fit in the buffer
+ */
+int DS_BufferAppendBytes (DS_Buffer* buffer, const void* data, const size_t len)
+{
+    /* Check arguments */
+    assert (buffer);
+    assert (data || len == 0);
+
+    /* Data does not fit in the buffer */
+    if (len > buffer->size - buffer->len) {
+        buffer->overflow = 1;
+        return 0;
+    }
+
+    /* Copy the data */
+    if (len > 0)
+        memcpy (buffer->data + buffer->len, data, len);
+
+    buffer->len += len;
+    return 1;
+}
+
+/**
+ * Returns a newly allocated string with a copy of the data written in the
+ * given \a buffer
+ */
+DS_String DS_BufferToString (const DS_Buffer* buffer)
+{
+    /* Check arguments */
+    assert (buffer);
+
+    /* Copy the buffer data */
+    DS_String string = DS_StrNewLen (buffer->len);
+    if (buffer->len > 0)
+        memcpy (string.buf, buffer->data, buffer->len);
+
+    return string;
+}
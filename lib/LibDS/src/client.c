@@ -196,15 +196,18 @@ char* DS_GetAppliedRobotAddress (void)
  */
 char* DS_GetStatusString (void)
 {
-    if (!CFG_GetRobotCommunications())
+    DS_State state;
+    CFG_GetState (&state);
+
+    if (!state.robot_communications)
         return "No Robot Communications";
 
-    else if (!CFG_GetRobotCode())
+    else if (!state.robot_code)
         return "No Robot Code";
 
-    int enabled = CFG_GetRobotEnabled();
+    int enabled = state.robot_enabled;
 
-    switch (CFG_GetControlMode()) {
+    switch (state.control_mode) {
     case DS_CONTROL_TELEOPERATED:
         return enabled ? "Teleoperated Enabled" : "Teleoperated Disabled";
         break;
@@ -219,12 +222,25 @@ char* DS_GetStatusString (void)
     return "Status Error";
 }
 
+/**
+ * Copies the robot and client state into the given \a state. Use this
+ * function when you need several values, all of them will come from the
+ * same update (e.g. the same robot packet).
+ */
+void DS_GetState (DS_State* state)
+{
+    if (state)
+        CFG_GetState (state);
+}
+
 /**
  * Returns the current team number
  */
 int DS_GetTeamNumber (void)
 {
-    return CFG_GetTeamNumber();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.team;
 }
 
 /**
@@ -232,7 +248,9 @@ int DS_GetTeamNumber (void)
  */
 int DS_GetRobotCode (void)
 {
-    return CFG_GetRobotCode();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.robot_code;
 }
 
 /**
@@ -255,7 +273,9 @@ int DS_GetCanBeEnabled (void)
  */
 int DS_GetRobotEnabled (void)
 {
-    return CFG_GetRobotEnabled();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.robot_enabled;
 }
 
 /**
@@ -263,7 +283,9 @@ int DS_GetRobotEnabled (void)
  */
 int DS_GetRobotCPUUsage (void)
 {
-    return CFG_GetRobotCPUUsage();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.cpu_usage;
 }
 
 /**
@@ -271,7 +293,9 @@ int DS_GetRobotCPUUsage (void)
  */
 int DS_GetRobotRAMUsage (void)
 {
-    return CFG_GetRobotRAMUsage();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.ram_usage;
 }
 
 /**
@@ -279,7 +303,9 @@ int DS_GetRobotRAMUsage (void)
  */
 int DS_GetRobotDiskUsage (void)
 {
-    return CFG_GetRobotDiskUsage();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.disk_usage;
 }
 
 /**
@@ -287,7 +313,9 @@ int DS_GetRobotDiskUsage (void)
  */
 float DS_GetRobotVoltage (void)
 {
-    return CFG_GetRobotVoltage();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.robot_voltage;
 }
 
 /**
@@ -296,7 +324,9 @@ float DS_GetRobotVoltage (void)
  */
 DS_Alliance DS_GetAlliance (void)
 {
-    return CFG_GetAlliance();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.alliance;
 }
 
 /**
@@ -305,7 +335,9 @@ DS_Alliance DS_GetAlliance (void)
  */
 DS_Position DS_GetPosition (void)
 {
-    return CFG_GetPosition();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.position;
 }
 
 /**
@@ -313,7 +345,9 @@ DS_Position DS_GetPosition (void)
  */
 int DS_GetEmergencyStopped (void)
 {
-    return CFG_GetEmergencyStopped();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.emergency_stopped;
 }
 
 /**
@@ -321,7 +355,9 @@ int DS_GetEmergencyStopped (void)
  */
 int DS_GetFMSCommunications (void)
 {
-    return CFG_GetFMSCommunications();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.fms_communications;
 }
 
 /**
@@ -329,7 +365,9 @@ int DS_GetFMSCommunications (void)
  */
 int DS_GetRadioCommunications (void)
 {
-    return CFG_GetRadioCommunications();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.radio_communications;
 }
 
 /**
@@ -337,7 +375,9 @@ int DS_GetRadioCommunications (void)
  */
 int DS_GetRobotCommunications (void)
 {
-    return CFG_GetRobotCommunications();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.robot_communications;
 }
 
 /**
@@ -345,7 +385,9 @@ int DS_GetRobotCommunications (void)
  */
 int DS_GetRobotCANUtilization (void)
 {
-    return CFG_GetCANUtilization();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.can_utilization;
 }
 
 /**
@@ -353,7 +395,9 @@ int DS_GetRobotCANUtilization (void)
  */
 DS_ControlMode DS_GetControlMode (void)
 {
-    return CFG_GetControlMode();
+    DS_State state;
+    CFG_GetState (&state);
+    return state.control_mode;
 }
 
 /**
@@ -22,14 +22,17 @@
  */
 
 #include "DS_Utils.h"
+#include "DS_Atomic.h"
 #include "DS_Client.h"
 #include "DS_Events.h"
 #include "DS_Config.h"
 #include "DS_Protocol.h"
+#include "DS_Resolver.h"
 
 #include <math.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 /*
  * These variables hold the state(s) of the LibDS and its modules
@@ -50,6 +53,46 @@ static DS_Position robot_position = DS_POSITION_1;
 static DS_Alliance robot_alliance = DS_ALLIANCE_RED;
 static DS_ControlMode control_mode = DS_CONTROL_TELEOPERATED;
 
+/*
+ * Packet fields that changed since the last call to CFG_TakeDirtyFlags()
+ */
+static long dirty_flags = CFG_DIRTY_ALL;
+
+/*
+ * Published copy of the state, it is protected by a sequence lock. The
+ * sequence is odd while the state is being written, readers retry until
+ * they copy the state with an even (and unchanged) sequence.
+ */
+static DS_State published = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    DS_POSITION_1, DS_ALLIANCE_RED, DS_CONTROL_TELEOPERATED
+};
+static long state_sequence = 0;
+
+/*
+ * Publication state, the state is not published while a packet is being
+ * interpreted (see CFG_BeginUpdate()) and the robot events are queued until
+ * the state is published.
+ *
+ * The update mutex is held while a packet is interpreted and while the state
+ * is published, so only one thread publishes at a time and no thread
+ * publishes the state of a half-interpreted packet. It is recursive, since
+ * the setters are also called while a packet is interpreted.
+ */
+static long update_depth = 0;
+static long state_changed = 0;
+static long pending_events = 0;
+static pthread_mutex_t update_mutex;
+static pthread_once_t update_mutex_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Marks the packet fields that depend on the changed configuration value
+ */
+static void mark_dirty (const int flags)
+{
+    DS_AtomicOr (&dirty_flags, flags);
+}
+
 /**
  * Ensures that the given \a input number is either \c 0 or \c 1
  */
@@ -78,25 +121,112 @@ static int respect_range (const int input, const int min, const int max)
 }
 
 /**
- * Creates and fills a robot event with the given \a type header
+ * Initializes the (recursive) update mutex
  */
-static void create_robot_event (const DS_EventType type)
+static void init_update_mutex (void)
 {
-    DS_Event event;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init (&attr);
+    pthread_mutexattr_settype (&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init (&update_mutex, &attr);
+    pthread_mutexattr_destroy (&attr);
+}
+
+/**
+ * Locks the update mutex (the mutex is initialized on first use)
+ */
+static void lock_updates (void)
+{
+    pthread_once (&update_mutex_once, &init_update_mutex);
+    pthread_mutex_lock (&update_mutex);
+}
 
-    event.robot.type = type;
-    event.robot.code = CFG_GetRobotCode();
-    event.robot.mode = CFG_GetControlMode();
-    event.robot.enabled = CFG_GetRobotEnabled();
-    event.robot.voltage = CFG_GetRobotVoltage();
-    event.robot.can_util = CFG_GetCANUtilization();
-    event.robot.cpu_usage = CFG_GetRobotCPUUsage();
-    event.robot.ram_usage = CFG_GetRobotRAMUsage();
-    event.robot.disk_usage = CFG_GetRobotDiskUsage();
-    event.robot.estopped = CFG_GetEmergencyStopped();
-    event.robot.connected = CFG_GetRobotCommunications();
+/**
+ * Copies the current state into the published state and creates the queued
+ * robot events, the events are filled with the published state.
+ * This function must be called with the update mutex locked
+ */
+static void publish_state (void)
+{
+    int type;
+    long events;
+    DS_State state;
 
-    DS_AddEvent (&event);
+    /* Nothing to publish */
+    if (!DS_AtomicExchange (&state_changed, 0))
+        return;
+
+    /* Get the current state */
+    state.team = CFG_GetTeamNumber();
+    state.robot_code = CFG_GetRobotCode();
+    state.robot_enabled = CFG_GetRobotEnabled();
+    state.cpu_usage = CFG_GetRobotCPUUsage();
+    state.ram_usage = CFG_GetRobotRAMUsage();
+    state.disk_usage = CFG_GetRobotDiskUsage();
+    state.can_utilization = CFG_GetCANUtilization();
+    state.robot_voltage = CFG_GetRobotVoltage();
+    state.emergency_stopped = CFG_GetEmergencyStopped();
+    state.fms_communications = CFG_GetFMSCommunications();
+    state.radio_communications = CFG_GetRadioCommunications();
+    state.robot_communications = CFG_GetRobotCommunications();
+    state.position = CFG_GetPosition();
+    state.alliance = CFG_GetAlliance();
+    state.control_mode = CFG_GetControlMode();
+
+    /* Write the state, the sequence is odd while we write it */
+    DS_AtomicAdd (&state_sequence, 1);
+    published = state;
+    DS_AtomicAdd (&state_sequence, 1);
+
+    events = DS_AtomicExchange (&pending_events, 0);
+
+    /* Create the queued robot events */
+    for (type = 0; type < 32; ++type) {
+        if (events & (1L << type)) {
+            DS_Event event;
+            event.robot.type = (DS_EventType) type;
+            event.robot.code = state.robot_code;
+            event.robot.mode = state.control_mode;
+            event.robot.enabled = state.robot_enabled;
+            event.robot.voltage = state.robot_voltage;
+            event.robot.can_util = state.can_utilization;
+            event.robot.cpu_usage = state.cpu_usage;
+            event.robot.ram_usage = state.ram_usage;
+            event.robot.disk_usage = state.disk_usage;
+            event.robot.estopped = state.emergency_stopped;
+            event.robot.connected = state.robot_communications;
+            DS_AddEvent (&event);
+        }
+    }
+}
+
+/**
+ * Publishes the changed state before returning, so the caller always reads
+ * back its own changes.
+ *
+ * If another thread is interpreting a packet, we wait until it is done. If
+ * the calling thread is interpreting a packet, the state is published when
+ * the packet is done.
+ */
+static void state_updated (void)
+{
+    lock_updates();
+    DS_AtomicExchange (&state_changed, 1);
+
+    if (update_depth == 0)
+        publish_state();
+
+    pthread_mutex_unlock (&update_mutex);
+}
+
+/**
+ * Queues a robot event with the given \a type header, the event will be
+ * filled with the state that is published with it
+ */
+static void create_robot_event (const DS_EventType type)
+{
+    DS_AtomicOr (&pending_events, 1L << type);
+    state_updated();
 }
 
 /**
@@ -135,6 +265,16 @@ void CFG_AddNetConsoleMessage (const DS_String* msg)
     DS_AddEvent (&event);
 }
 
+/**
+ * Removes the cached lookup of the given \a address (a host that stopped
+ * answering) and frees the string
+ */
+static void forget_address (char* address)
+{
+    DS_ResolverInvalidate (address);
+    DS_FREE (address);
+}
+
 /**
  * Re-applies the network addresses of the FMS, radio and robot.
  * This function is called when the team number is changed or when a watchdog
@@ -158,12 +298,102 @@ void CFG_ReconfigureAddresses (const int flags)
     }
 
     if (flags & RECONFIGURE_ROBOT) {
+        char* custom = DS_GetCustomRobotAddress();
         char* address = DS_GetAppliedRobotAddress();
-        DS_SocketChangeAddress (&DS_CurrentProtocol()->robot_socket, address);
+
+        /* Use the address set by the user */
+        if (strlen (custom) > 0)
+            DS_SocketChangeAddress (&DS_CurrentProtocol()->robot_socket, address);
+
+        /* Probe the protocol address and the candidates of the protocol */
+        else {
+            int i;
+            int count = 0;
+            DS_String extra [DS_SOCKET_CANDIDATES - 1];
+            char* hosts [DS_SOCKET_CANDIDATES - 1];
+            const char* candidates [DS_SOCKET_CANDIDATES];
+
+            if (DS_CurrentProtocol()->robot_candidates)
+                count = DS_CurrentProtocol()->robot_candidates (extra, DS_SOCKET_CANDIDATES - 1);
+
+            candidates [0] = address;
+            for (i = 0; i < count; ++i) {
+                hosts [i] = DS_StrToChar (&extra [i]);
+                candidates [i + 1] = hosts [i];
+                DS_StrRmBuf (&extra [i]);
+            }
+
+            DS_SocketChangeAddresses (&DS_CurrentProtocol()->robot_socket,
+                                      candidates, count + 1);
+
+            for (i = 0; i < count; ++i)
+                DS_FREE (hosts [i]);
+        }
+
+        DS_FREE (custom);
         DS_FREE (address);
     }
 }
 
+/**
+ * Defers the publication of the state until \c CFG_EndUpdate() is called,
+ * protocols call this function before interpreting a packet so that the
+ * client never sees a state with values from different packets.
+ *
+ * Other threads that change the state wait until \c CFG_EndUpdate() is
+ * called before publishing their changes.
+ */
+void CFG_BeginUpdate (void)
+{
+    lock_updates();
+    ++update_depth;
+}
+
+/**
+ * Publishes the state changes made since \c CFG_BeginUpdate() was called
+ */
+void CFG_EndUpdate (void)
+{
+    --update_depth;
+
+    if (update_depth == 0)
+        publish_state();
+
+    pthread_mutex_unlock (&update_mutex);
+}
+
+/**
+ * Copies the last published state into the given \a state. The copy is
+ * consistent (all the values come from the same update), even if the state
+ * is being changed by another thread.
+ */
+void CFG_GetState (DS_State* state)
+{
+    long sequence;
+
+    /* Check arguments */
+    assert (state);
+
+    /* Copy the state until it is not modified while copying it */
+    do {
+        sequence = DS_AtomicLoad (&state_sequence);
+        *state = published;
+        DS_AtomicFence();
+    } while ((sequence & 1) || sequence != DS_AtomicLoad (&state_sequence));
+}
+
+/**
+ * Returns the packet fields (\c CFG_DIRTY_* flags) whose source values
+ * have changed since the last call to this function and clears them.
+ *
+ * Protocols use this function to re-generate only the parts of their
+ * packets that are affected by the configuration changes.
+ */
+int CFG_TakeDirtyFlags (void)
+{
+    return (int) DS_AtomicExchange (&dirty_flags, 0);
+}
+
 /**
  * Returns the current team number, which may be used by the protocols to
  * specifiy the default addresses and generate specialized packets
@@ -315,6 +545,7 @@ void CFG_SetTeamNumber (const int number)
 {
     if (team != number) {
         team = number;
+        state_updated();
         CFG_ReconfigureAddresses (RECONFIGURE_ALL);
     }
 }
@@ -326,6 +557,7 @@ void CFG_SetRobotEnabled (const int enabled)
 {
     if (robot_enabled != to_boolean (enabled)) {
         robot_enabled = to_boolean (enabled) && !CFG_GetEmergencyStopped();
+        mark_dirty (CFG_DIRTY_CONTROL);
         create_robot_event (DS_ROBOT_ENABLED_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
     }
@@ -385,6 +617,7 @@ void CFG_SetEmergencyStopped (const int stopped)
 {
     if (emergency_stopped != to_boolean (stopped)) {
         emergency_stopped = to_boolean (stopped);
+        mark_dirty (CFG_DIRTY_CONTROL);
         create_robot_event (DS_ROBOT_ESTOP_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
     }
@@ -397,6 +630,7 @@ void CFG_SetAlliance (const DS_Alliance alliance)
 {
     if (robot_alliance != alliance) {
         robot_alliance = alliance;
+        mark_dirty (CFG_DIRTY_STATION);
         create_robot_event (DS_ROBOT_STATION_CHANGED);
     }
 }
@@ -408,6 +642,7 @@ void CFG_SetPosition (const DS_Position position)
 {
     if (robot_position != position) {
         robot_position = position;
+        mark_dirty (CFG_DIRTY_STATION);
         create_robot_event (DS_ROBOT_STATION_CHANGED);
     }
 }
@@ -430,6 +665,7 @@ void CFG_SetControlMode (const DS_ControlMode mode)
 {
     if (control_mode != mode) {
         control_mode = mode;
+        mark_dirty (CFG_DIRTY_CONTROL);
         create_robot_event (DS_ROBOT_MODE_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
     }
@@ -442,6 +678,8 @@ void CFG_SetFMSCommunications (const int communications)
 {
     if (fms_communications != to_boolean (communications)) {
         fms_communications = to_boolean (communications);
+        mark_dirty (CFG_DIRTY_CONTROL);
+        state_updated();
 
         DS_Event event;
         event.fms.type = DS_FMS_COMMS_CHANGED;
@@ -459,6 +697,7 @@ void CFG_SetRadioCommunications (const int communications)
 {
     if (radio_communications != to_boolean (communications)) {
         radio_communications = to_boolean (communications);
+        state_updated();
 
         DS_Event event;
         event.radio.type = DS_RADIO_COMMS_CHANGED;
@@ -476,6 +715,7 @@ void CFG_SetRobotCommunications (const int communications)
 {
     if (robot_communications != to_boolean (communications)) {
         robot_communications = to_boolean (communications);
+        mark_dirty (CFG_DIRTY_REQUEST);
         create_robot_event (DS_ROBOT_COMMS_CHANGED);
         create_robot_event (DS_STATUS_STRING_CHANGED);
 
@@ -489,6 +729,7 @@ void CFG_SetRobotCommunications (const int communications)
 void CFG_FMSWatchdogExpired (void)
 {
     CFG_SetFMSCommunications (0);
+    forget_address (DS_GetAppliedFMSAddress());
     CFG_ReconfigureAddresses (RECONFIGURE_FMS);
 }
 
@@ -498,6 +739,7 @@ void CFG_FMSWatchdogExpired (void)
 void CFG_RadioWatchdogExpired (void)
 {
     CFG_SetRadioCommunications (0);
+    forget_address (DS_GetAppliedRadioAddress());
     CFG_ReconfigureAddresses (RECONFIGURE_RADIO);
 }
 
@@ -507,6 +749,7 @@ void CFG_RadioWatchdogExpired (void)
 void CFG_RobotWatchdogExpired (void)
 {
     /* Reset everything to safe state */
+    CFG_BeginUpdate();
     CFG_SetRobotCode (0);
     CFG_SetRobotVoltage (0);
     CFG_SetRobotEnabled (0);
@@ -515,8 +758,11 @@ void CFG_RobotWatchdogExpired (void)
     CFG_SetRobotDiskUsage (0);
     CFG_SetEmergencyStopped (0);
     CFG_SetRobotCommunications (0);
+    CFG_EndUpdate();
 
-    /* Force the sockets to perform another lookup */
+    /* Force the sockets to perform another lookup (the cached address
+     * of the robot may be the one that stopped answering) */
+    forget_address (DS_GetAppliedRobotAddress());
     CFG_ReconfigureAddresses (RECONFIGURE_ROBOT);
 
     /* Update the status label */
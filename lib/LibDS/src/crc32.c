@@ -44,6 +44,45 @@
 
 #include <assert.h>
 
+/*
+ * Hardware accelerated implementations, they are only used if the CPU
+ * supports the required instructions (checked in CRC32_Init())
+ */
+#if defined __x86_64__ || defined __i386__ || defined _M_X64 || defined _M_IX86
+    #if defined _MSC_VER
+        #define USE_PCLMUL 1
+        #define PCLMUL_TARGET
+        #include <intrin.h>
+        #include <wmmintrin.h>
+    #elif defined __GNUC__ && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+        #define USE_PCLMUL 1
+        #define PCLMUL_TARGET __attribute__ ((target ("pclmul,sse2")))
+        #include <cpuid.h>
+        #include <wmmintrin.h>
+    #endif
+#elif defined __ARM_FEATURE_CRC32
+    #define USE_ARM_CRC32 1
+    #define ARM_CRC32_TARGET
+    #include <arm_acle.h>
+#elif defined __aarch64__ && defined __linux__ && \
+      ((defined __clang__ && __clang_major__ >= 16) || \
+       (!defined __clang__ && defined __GNUC__ && __GNUC__ >= 9))
+    /* Generic ARMv8 build, the CRC32 extension is checked with the HWCAPs */
+    #define USE_ARM_CRC32 1
+    #define USE_ARM_HWCAP 1
+    #if defined __clang__
+        #define ARM_CRC32_TARGET __attribute__ ((target ("crc")))
+    #else
+        #define ARM_CRC32_TARGET __attribute__ ((target ("+crc")))
+    #endif
+    #include <arm_acle.h>
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+    #ifndef HWCAP_CRC32
+        #define HWCAP_CRC32 (1 << 7)
+    #endif
+#endif
+
 static uint32_t crc32_tab[] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
     0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
@@ -90,17 +129,256 @@ static uint32_t crc32_tab[] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-uint32_t DS_CRC32 (const void* buf, size_t size)
+/*
+ * Slice-by-8 lookup tables, the first table is crc32_tab
+ */
+static uint32_t slice_tab [8][256];
+
+/**
+ * Reads a little-endian 32-bit word from the given \a data
+ */
+static uint32_t read_word (const uint8_t* data)
 {
-    assert (buf);
+    return (uint32_t) data [0]
+           | ((uint32_t) data [1] << 8)
+           | ((uint32_t) data [2] << 16)
+           | ((uint32_t) data [3] << 24);
+}
+
+/**
+ * Updates the given \a crc register with \a size bytes, one byte at a time
+ */
+static uint32_t crc32_bytes (uint32_t crc, const uint8_t* p, size_t size)
+{
+    while (size--)
+        crc = crc32_tab [ (crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+/**
+ * Updates the given \a crc register with \a size bytes, eight bytes at a time
+ */
+static uint32_t crc32_slice_by_8 (uint32_t crc, const uint8_t* p, size_t size)
+{
+    while (size >= 8) {
+        uint32_t one = read_word (p) ^ crc;
+        uint32_t two = read_word (p + 4);
+
+        crc = slice_tab [7][one & 0xFF]
+              ^ slice_tab [6][(one >> 8) & 0xFF]
+              ^ slice_tab [5][(one >> 16) & 0xFF]
+              ^ slice_tab [4][one >> 24]
+              ^ slice_tab [3][two & 0xFF]
+              ^ slice_tab [2][(two >> 8) & 0xFF]
+              ^ slice_tab [1][(two >> 16) & 0xFF]
+              ^ slice_tab [0][two >> 24];
+
+        p += 8;
+        size -= 8;
+    }
+
+    return crc32_bytes (crc, p, size);
+}
+
+#if defined USE_PCLMUL
+/*
+ * Folding constants for the CRC32 polynomial, see "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction" (Intel, 2009)
+ */
+static const uint64_t k1k2 [2] = { 0x0154442bd4, 0x01c6e41596 };
+static const uint64_t k3k4 [2] = { 0x01751997d0, 0x00ccaa009e };
+static const uint64_t k5k0 [2] = { 0x0163cd6124, 0x0000000000 };
+static const uint64_t poly [2] = { 0x01db710641, 0x01f7011641 };
+
+/**
+ * Updates the given \a crc register by folding 64-byte blocks with carry-less
+ * multiplications, the bytes that do not fill a 16-byte block are processed
+ * with the slice-by-8 implementation
+ */
+PCLMUL_TARGET
+static uint32_t crc32_pclmul (uint32_t crc, const uint8_t* p, size_t size)
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    /* Not enough data to fold */
+    if (size < 64)
+        return crc32_slice_by_8 (crc, p, size);
+
+    /* Load the first block */
+    x1 = _mm_loadu_si128 ((const __m128i*) (p + 0x00));
+    x2 = _mm_loadu_si128 ((const __m128i*) (p + 0x10));
+    x3 = _mm_loadu_si128 ((const __m128i*) (p + 0x20));
+    x4 = _mm_loadu_si128 ((const __m128i*) (p + 0x30));
+    x1 = _mm_xor_si128 (x1, _mm_cvtsi32_si128 ((int) crc));
+    x0 = _mm_loadu_si128 ((const __m128i*) k1k2);
+    p += 64;
+    size -= 64;
+
+    /* Fold 64-byte blocks */
+    while (size >= 64) {
+        x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128 (x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128 (x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128 (x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128 (x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128 (x4, x0, 0x11);
+
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5), _mm_loadu_si128 ((const __m128i*) (p + 0x00)));
+        x2 = _mm_xor_si128 (_mm_xor_si128 (x2, x6), _mm_loadu_si128 ((const __m128i*) (p + 0x10)));
+        x3 = _mm_xor_si128 (_mm_xor_si128 (x3, x7), _mm_loadu_si128 ((const __m128i*) (p + 0x20)));
+        x4 = _mm_xor_si128 (_mm_xor_si128 (x4, x8), _mm_loadu_si128 ((const __m128i*) (p + 0x30)));
+
+        p += 64;
+        size -= 64;
+    }
 
-    const uint8_t* p;
-    uint32_t crc = 0xFFFFFFFFUL;
+    /* Fold the four registers into one */
+    x0 = _mm_loadu_si128 ((const __m128i*) k3k4);
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x3), x5);
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x4), x5);
 
-    p = buf;
+    /* Fold 16-byte blocks */
+    while (size >= 16) {
+        x2 = _mm_loadu_si128 ((const __m128i*) p);
+        x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+
+        p += 16;
+        size -= 16;
+    }
+
+    /* Fold 128 bits to 64 bits */
+    x2 = _mm_clmulepi64_si128 (x1, x0, 0x10);
+    x3 = _mm_setr_epi32 (~0, 0, ~0, 0);
+    x1 = _mm_srli_si128 (x1, 8);
+    x1 = _mm_xor_si128 (x1, x2);
+    x0 = _mm_loadl_epi64 ((const __m128i*) k5k0);
+    x2 = _mm_srli_si128 (x1, 4);
+    x1 = _mm_and_si128 (x1, x3);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_loadu_si128 ((const __m128i*) poly);
+    x2 = _mm_and_si128 (x1, x3);
+    x2 = _mm_clmulepi64_si128 (x2, x0, 0x10);
+    x2 = _mm_and_si128 (x2, x3);
+    x2 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+    crc = (uint32_t) _mm_cvtsi128_si32 (_mm_srli_si128 (x1, 4));
+
+    /* Process the remaining bytes */
+    return crc32_slice_by_8 (crc, p, size);
+}
+
+/**
+ * Returns \c 1 if the CPU supports the PCLMULQDQ and SSE2 instructions
+ */
+static int pclmul_supported (void)
+{
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+
+#if defined _MSC_VER
+    int info [4];
+    __cpuid (info, 1);
+    ecx = (unsigned int) info [2];
+    edx = (unsigned int) info [3];
+#else
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx))
+        return 0;
+#endif
+
+    return (ecx & (1 << 1)) && (edx & (1 << 26));
+}
+#endif
+
+#if defined USE_ARM_CRC32
+/**
+ * Updates the given \a crc register with the ARMv8 CRC32 instructions
+ */
+ARM_CRC32_TARGET
+static uint32_t crc32_arm (uint32_t crc, const uint8_t* p, size_t size)
+{
+    while (size >= 8) {
+        uint64_t word = (uint64_t) read_word (p) | ((uint64_t) read_word (p + 4) << 32);
+        crc = __crc32d (crc, word);
+        p += 8;
+        size -= 8;
+    }
 
     while (size--)
-        crc = crc32_tab [ (crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        crc = __crc32b (crc, *p++);
+
+    return crc;
+}
 
-    return crc ^ 0xFFFFFFFFUL;
+/**
+ * Returns \c 1 if the CPU supports the ARMv8 CRC32 instructions
+ */
+static int arm_crc32_supported (void)
+{
+#if defined USE_ARM_HWCAP
+    return (getauxval (AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    return 1;
+#endif
+}
+#endif
+
+/*
+ * Implementation used by DS_CRC32(), it is selected by CRC32_Init()
+ */
+static uint32_t (*crc32_update) (uint32_t, const uint8_t*, size_t) = &crc32_bytes;
+
+/**
+ * Generates the slice-by-8 tables and selects the fastest CRC32
+ * implementation supported by the CPU
+ */
+void CRC32_Init (void)
+{
+    int i, j;
+
+    /* Generate the slice-by-8 tables */
+    for (i = 0; i < 256; ++i)
+        slice_tab [0][i] = crc32_tab [i];
+    for (i = 1; i < 8; ++i) {
+        for (j = 0; j < 256; ++j) {
+            uint32_t prev = slice_tab [i - 1][j];
+            slice_tab [i][j] = (prev >> 8) ^ crc32_tab [prev & 0xFF];
+        }
+    }
+
+    /* Select the implementation */
+    crc32_update = &crc32_slice_by_8;
+#if defined USE_PCLMUL
+    if (pclmul_supported())
+        crc32_update = &crc32_pclmul;
+#elif defined USE_ARM_CRC32
+    if (arm_crc32_supported())
+        crc32_update = &crc32_arm;
+#endif
+}
+
+/**
+ * Returns the CRC32 checksum of the first \a size bytes of the given \a buf
+ */
+uint32_t DS_CRC32 (const void* buf, size_t size)
+{
+    assert (buf);
+    return crc32_update (0xFFFFFFFFUL, (const uint8_t*) buf, size) ^ 0xFFFFFFFFUL;
 }
@@ -21,59 +21,377 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "DS_Queue.h"
+#include "DS_Utils.h"
+#include "DS_Atomic.h"
 #include "DS_Events.h"
 
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
 
-static DS_Queue events;
+/*
+ * Number of slots in the event ring (must be a power of 2)
+ */
+#define QUEUE_SIZE 256
+#define QUEUE_MASK (QUEUE_SIZE - 1)
+
+/*
+ * Number of event types that can be coalesced (all event type values
+ * must be lower than this number)
+ */
+#define EVENT_TYPES 0x20
+
+/**
+ * A slot in the event ring, the sequence number tells producers and the
+ * consumer if the slot is free or if it holds an event that can be read
+ */
+typedef struct {
+    unsigned long sequence;
+    DS_Event event;
+} EventSlot;
+
+/**
+ * Holds the latest event of a given type that did not fit in the event ring
+ * (or that is coalesced by default, such as telemetry events). The sequence
+ * number is odd while a producer writes the event (seqlock) and grows by
+ * two with every written event.
+ */
+typedef struct {
+    unsigned long sequence;
+    unsigned long delivered;
+    DS_Event event;
+} CoalescedEvent;
+
+/*
+ * Bounded MPSC event ring (based on Dmitry Vyukov's bounded queue)
+ */
+static EventSlot ring [QUEUE_SIZE];
+static unsigned long enqueue_pos = 0;
+static unsigned long dequeue_pos = 0;
+
+/*
+ * Overflow handling
+ */
+static unsigned long dropped_events = 0;
+static CoalescedEvent coalesced [EVENT_TYPES];
+static DS_EventOverflowPolicy overflow_policy = DS_EVENTS_COALESCE;
+
+/*
+ * Telemetry coalescing
+ */
+static int coalesce_telemetry = 1;
+static unsigned long merged_events [EVENT_TYPES];
+
+/**
+ * Returns \c 1 if the given event \a type reports a telemetry value that
+ * changes with (almost) every robot packet
+ */
+static int is_telemetry (const DS_EventType type)
+{
+    switch (type) {
+    case DS_ROBOT_VOLTAGE_CHANGED:
+    case DS_ROBOT_CAN_UTIL_CHANGED:
+    case DS_ROBOT_CPU_INFO_CHANGED:
+    case DS_ROBOT_RAM_INFO_CHANGED:
+    case DS_ROBOT_DISK_INFO_CHANGED:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Releases the memory owned by the given \a event (if any)
+ */
+static void discard_event (DS_Event* event)
+{
+    assert (event);
+
+    if (event->type == DS_NETCONSOLE_NEW_MESSAGE)
+        DS_FREE (event->netconsole.message);
+}
+
+/**
+ * Copies the given \a event into the event ring
+ *
+ * \returns \c 1 on success, \c 0 if the ring is full
+ */
+static int ring_push (const DS_Event* event)
+{
+    EventSlot* slot;
+    unsigned long pos = DS_AtomicLoad (&enqueue_pos);
+
+    /* Reserve a free slot */
+    while (1) {
+        slot = &ring [pos & QUEUE_MASK];
+        long diff = (long) (DS_AtomicLoad (&slot->sequence) - pos);
+
+        if (diff == 0) {
+            if (DS_AtomicCAS (&enqueue_pos, pos, pos + 1))
+                break;
+        }
+
+        else if (diff < 0)
+            return 0;
+
+        pos = DS_AtomicLoad (&enqueue_pos);
+    }
+
+    /* Write the event and publish it */
+    memcpy (&slot->event, event, sizeof (DS_Event));
+    DS_AtomicStore (&slot->sequence, pos + 1);
+
+    return 1;
+}
+
+/**
+ * Moves the oldest event in the ring to the given \a event
+ *
+ * \returns \c 1 on success, \c 0 if the ring is empty
+ */
+static int ring_pop (DS_Event* event)
+{
+    EventSlot* slot;
+    unsigned long pos = DS_AtomicLoad (&dequeue_pos);
+
+    /* Find the oldest published slot */
+    while (1) {
+        slot = &ring [pos & QUEUE_MASK];
+        long diff = (long) (DS_AtomicLoad (&slot->sequence) - (pos + 1));
+
+        if (diff == 0) {
+            if (DS_AtomicCAS (&dequeue_pos, pos, pos + 1))
+                break;
+        }
+
+        else if (diff < 0)
+            return 0;
+
+        pos = DS_AtomicLoad (&dequeue_pos);
+    }
+
+    /* Read the event and release the slot */
+    memcpy (event, &slot->event, sizeof (DS_Event));
+    DS_AtomicStore (&slot->sequence, pos + QUEUE_SIZE);
+
+    return 1;
+}
 
 /**
- * Initializes the event queue with an initial support for 50 events
+ * Stores the given \a event as the latest event of its type, replacing
+ * any undelivered event of the same type
+ */
+static void coalesce_event (const DS_Event* event)
+{
+    assert (event);
+    assert (event->type < EVENT_TYPES);
+
+    CoalescedEvent* slot = &coalesced [event->type];
+
+    /* Lock the slot for writing (make the sequence odd) */
+    unsigned long seq;
+    do {
+        seq = DS_AtomicLoad (&slot->sequence);
+    } while ((seq & 1) || !DS_AtomicCAS (&slot->sequence, seq, seq + 1));
+
+    /* Write the event and unlock the slot */
+    memcpy (&slot->event, event, sizeof (DS_Event));
+    DS_AtomicStore (&slot->sequence, seq + 2);
+}
+
+/**
+ * Returns \c 1 if the coalesced slot of the given event \a type holds an
+ * event that has not been delivered yet
+ */
+static int has_coalesced_event (const DS_EventType type)
+{
+    assert (type < EVENT_TYPES);
+
+    CoalescedEvent* slot = &coalesced [type];
+    return DS_AtomicLoad (&slot->sequence) != DS_AtomicLoad (&slot->delivered);
+}
+
+/**
+ * Copies the first undelivered coalesced event to the given \a event
+ *
+ * \returns \c 1 on success, \c 0 if there are no coalesced events
+ */
+static int pop_coalesced_event (DS_Event* event)
+{
+    int type;
+    for (type = 0; type < EVENT_TYPES; ++type) {
+        CoalescedEvent* slot = &coalesced [type];
+
+        /* Read the slot until we get a consistent copy */
+        unsigned long seq;
+        do {
+            seq = DS_AtomicLoad (&slot->sequence);
+            if (seq == slot->delivered)
+                break;
+
+            memcpy (event, &slot->event, sizeof (DS_Event));
+            DS_AtomicFence();
+        } while ((seq & 1) || seq != DS_AtomicLoad (&slot->sequence));
+
+        /* Mark the event as delivered and count the replaced events */
+        if (seq != slot->delivered) {
+            unsigned long written = (seq - slot->delivered) / 2;
+            DS_AtomicAdd (&merged_events [type], written - 1);
+            DS_AtomicStore (&slot->delivered, seq);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Initializes the event ring and the coalesced event slots
  */
 void Events_Init (void)
 {
-    DS_QueueInit (&events, 50, sizeof (DS_Event));
+    int i;
+    for (i = 0; i < QUEUE_SIZE; ++i)
+        DS_AtomicStore (&ring [i].sequence, (unsigned long) i);
+
+    memset (coalesced, 0, sizeof (coalesced));
+    memset (merged_events, 0, sizeof (merged_events));
+
+    DS_AtomicStore (&enqueue_pos, 0);
+    DS_AtomicStore (&dequeue_pos, 0);
+    DS_AtomicStore (&dropped_events, 0);
 }
 
 /**
- * De-allocates the event queue (that's all)
+ * Discards all pending events
  */
 void Events_Close (void)
 {
-    DS_QueueFree (&events);
+    DS_Event event;
+    while (DS_PollEvent (&event))
+        discard_event (&event);
 }
 
 /**
- * Adds the given \a event to the event queue
+ * Changes the way in which new events are handled when the event queue is
+ * full (e.g. when the application does not poll events fast enough):
+ *    - \c DS_EVENTS_COALESCE: only the latest event of each type is kept
+ *      (and delivered after the queued events), until it is delivered, the
+ *      new events of the same type replace it instead of being queued
+ *    - \c DS_EVENTS_DROP_OLDEST: the oldest queued event is discarded
+ *
+ * NetConsole messages cannot be coalesced, so they are dropped if the queue
+ * is full while using \c DS_EVENTS_COALESCE.
+ */
+void DS_SetEventOverflowPolicy (const DS_EventOverflowPolicy policy)
+{
+    overflow_policy = policy;
+}
+
+/**
+ * Enables or disables the coalescing of telemetry events (voltage, CAN, CPU,
+ * RAM and disk usage). When enabled (the default), only the latest event of
+ * each telemetry type is kept until the application polls it, so that the
+ * application handles O(types) events per poll instead of one event per
+ * received robot packet.
+ */
+void DS_SetEventCoalescing (const int enabled)
+{
+    coalesce_telemetry = (enabled != 0);
+}
+
+/**
+ * Returns the number of events of the given \a type that have been replaced
+ * by a newer event of the same type before the application polled them
+ */
+unsigned long DS_MergedEvents (const DS_EventType type)
+{
+    if (type < EVENT_TYPES)
+        return DS_AtomicLoad (&merged_events [type]);
+
+    return 0;
+}
+
+/**
+ * Returns the number of events that have been discarded because the event
+ * queue was full
+ */
+unsigned long DS_DroppedEvents (void)
+{
+    return DS_AtomicLoad (&dropped_events);
+}
+
+/**
+ * Adds the given \a event to the event queue.
+ *
+ * This function can be called from any thread and does not allocate memory,
+ * the event is copied into a fixed-size slot of the event ring.
  *
  * \param event the event to register in the event queue
  */
 void DS_AddEvent (DS_Event* event)
 {
     assert (event);
-    DS_QueuePush (&events, (void*) event);
+
+    /* Keep only the latest telemetry event of each type */
+    if (coalesce_telemetry && is_telemetry (event->type)) {
+        coalesce_event (event);
+        return;
+    }
+
+    /* An older event of this type is coalesced, replace it (if we queued
+     * the event, the older event would be delivered after it) */
+    if (overflow_policy == DS_EVENTS_COALESCE &&
+            event->type != DS_NETCONSOLE_NEW_MESSAGE &&
+            event->type < EVENT_TYPES && has_coalesced_event (event->type)) {
+        coalesce_event (event);
+        return;
+    }
+
+    /* Try to add the event directly */
+    if (ring_push (event))
+        return;
+
+    /* Queue is full, discard the oldest events until the event fits */
+    if (overflow_policy == DS_EVENTS_DROP_OLDEST) {
+        DS_Event oldest;
+        do {
+            if (ring_pop (&oldest)) {
+                discard_event (&oldest);
+                DS_AtomicAdd (&dropped_events, 1);
+            }
+        } while (!ring_push (event));
+    }
+
+    /* Queue is full, keep only the latest event of this type */
+    else if (event->type != DS_NETCONSOLE_NEW_MESSAGE && event->type < EVENT_TYPES)
+        coalesce_event (event);
+
+    /* Event cannot be coalesced, discard it */
+    else {
+        discard_event (event);
+        DS_AtomicAdd (&dropped_events, 1);
+    }
 }
 
 /**
  * Polls for currently pending events and copies the first event in the queue
  * to the given \a event object.
  *
+ * Coalesced events (telemetry events and events that did not fit in the
+ * queue) are delivered after the queued events. This function must only be called from a single
+ * thread at a time.
+ *
  * \returns 1 if there are any pending events, or 0 if there are none available.
  *
  * \param event we write the obtained event data here
  */
 int DS_PollEvent (DS_Event* event)
 {
-    DS_Event* front = (DS_Event*) DS_QueueGetFirst (&events);
+    assert (event);
 
-    if (front) {
-        DS_QueuePop (&events);
-        memcpy (event, front, sizeof (DS_Event));
+    if (ring_pop (event))
         return 1;
-    }
 
-    return 0;
+    return pop_coalesced_event (event);
 }
@@ -36,11 +36,13 @@ void DS_Init (void)
     if (!DS_Initialized()) {
         init = 1;
 
+        CRC32_Init();
         Timers_Init();
         Client_Init();
         Events_Init();
         Sockets_Init();
         Joysticks_Init();
+        Links_Init();
         Protocols_Init();
     }
 }
@@ -56,10 +58,12 @@ void DS_Close (void)
     if (DS_Initialized()) {
         init = 0;
 
-        Timers_Close();
-        Sockets_Close();
+        /* The protocol needs the timers, sockets and links to close */
         Protocols_Close();
+        Links_Close();
         Joysticks_Close();
+        Sockets_Close();
+        Timers_Close();
 
         Events_Close();
         Client_Close();
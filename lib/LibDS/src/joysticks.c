@@ -21,35 +21,66 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "DS_Array.h"
+#include "DS_Timer.h"
+#include "DS_Atomic.h"
 #include "DS_Config.h"
 #include "DS_Events.h"
 #include "DS_Joysticks.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 
 /**
- * Represents a joystick and its information
+ * Holds the layout and values of all the joysticks, the store is written by
+ * the client (joystick) thread and read by the event thread, so every access
+ * is serialized with \c store_mutex
  */
-typedef struct _joystick {
-    int* hats;       /**< An array with the hat angles */
-    float* axes;    /**< An array with the axis values */
-    int* buttons;    /**< An array with the button states */
-    int num_axes;    /**< The number of axes of the joystick */
-    int num_hats;    /**< The number of hats of the joystick */
-    int num_buttons; /**< The number of buttons of the joystick */
-} DS_Joystick;
+static DS_JoystickSnapshot store;
+static pthread_mutex_t store_mutex;
+
+/*
+ * Joysticks that changed since the last call to DS_TakeJoystickDirtyFlags()
+ */
+static unsigned long dirty_flags = ~0UL;
+
+/*
+ * Time (in usecs) of the oldest input that has not been copied into a
+ * snapshot yet and of the oldest input included in the last snapshot,
+ * both are protected by \c store_mutex
+ */
+static uint64_t input_time = 0;
+static uint64_t snapshot_time = 0;
+
+/*
+ * Input-to-wire latency statistics
+ */
+static uint64_t last_latency = 0;
+static uint64_t max_latency = 0;
+static uint64_t total_latency = 0;
+static unsigned long latency_samples = 0;
+static pthread_mutex_t latency_mutex;
 
 /**
- * Holds all the joysticks
+ * Marks the given \a joystick as changed
+ * \note The caller must hold \c store_mutex
  */
-static DS_Array array;
+static void mark_dirty (const int joystick)
+{
+    DS_AtomicOr (&dirty_flags, 1UL << (joystick < 31 ? joystick : 31));
+
+    /* Remember when the first unsent input was received */
+    if (input_time == 0)
+        input_time = DS_GetTimestamp();
+}
 
 /**
  * Registers a joystick event to the LibDS event system
  */
 static void register_event()
 {
+    DS_AtomicStore (&dirty_flags, ~0UL);
+
     DS_Event event;
     event.joystick.count = DS_GetJoystickCount();
     event.joystick.type = DS_JOYSTICK_COUNT_CHANGED;
@@ -57,43 +88,47 @@ static void register_event()
 }
 
 /**
- * Returns the joystick structure at the given index
- * If the joystick does not exist, this function shall return \c NULL
+ * Returns \c true if the given \a joystick exists and is valid
+ * \note The caller must hold \c store_mutex
  */
-static DS_Joystick* get_joystick (int joystick)
+static int joystick_exists (int joystick)
 {
-    if ((int) array.used > joystick)
-        return (DS_Joystick*) array.data [joystick];
-
-    return NULL;
+    return joystick >= 0 && joystick < store.count;
 }
 
 /**
- * Returns \c true if the given \a joystick exists and is valid
+ * Ensures that the given \a count is between \c 0 and \a max, a warning is
+ * printed if the count had to be reduced
  */
-static int joystick_exists (int joystick)
+static int limit_count (const int count, const int max, const char* name)
 {
-    if (DS_GetJoystickCount() > joystick)
-        return get_joystick (joystick) != NULL;
+    if (count > max) {
+        fprintf (stderr, "DS_JoystickAdd: Ignoring %d %s!\n", count - max, name);
+        return max;
+    }
 
-    return 0;
+    return count > 0 ? count : 0;
 }
 
 /**
- * Initializes the joystick array, with an initial support for 6 joysticks
+ * Initializes the joystick store
  */
 void Joysticks_Init (void)
 {
-    DS_ArrayInit (&array, 6);
+    memset (&store, 0, sizeof (store));
+    pthread_mutex_init (&store_mutex, NULL);
+    pthread_mutex_init (&latency_mutex, NULL);
+    DS_ResetInputLatency();
 }
 
 /**
- * De-allocates the joystick array data
+ * Removes every joystick from the store
  */
 void Joysticks_Close (void)
 {
-    DS_ArrayFree (&array);
-    register_event();
+    DS_JoysticksReset();
+    pthread_mutex_destroy (&store_mutex);
+    pthread_mutex_destroy (&latency_mutex);
 }
 
 /**
@@ -101,7 +136,24 @@ void Joysticks_Close (void)
  */
 int DS_GetJoystickCount (void)
 {
-    return (int) array.used;
+    pthread_mutex_lock (&store_mutex);
+    int count = store.count;
+    pthread_mutex_unlock (&store_mutex);
+
+    return count;
+}
+
+/**
+ * Returns a bitmask with the joysticks whose layout or values changed since
+ * the last call to this function and clears it. Bit \c n is set if joystick
+ * \c n changed, use the \c DS_JOYSTICK_DIRTY() macro to test it.
+ *
+ * Protocols use this function to re-generate only the joystick data of the
+ * joysticks that changed.
+ */
+unsigned long DS_TakeJoystickDirtyFlags (void)
+{
+    return DS_AtomicExchange (&dirty_flags, 0);
 }
 
 /**
@@ -110,10 +162,14 @@ int DS_GetJoystickCount (void)
  */
 int DS_GetJoystickNumHats (int joystick)
 {
+    int count = 0;
+
+    pthread_mutex_lock (&store_mutex);
     if (joystick_exists (joystick))
-        return get_joystick (joystick)->num_hats;
+        count = store.num_hats [joystick];
+    pthread_mutex_unlock (&store_mutex);
 
-    return 0;
+    return count;
 }
 
 /**
@@ -122,10 +178,14 @@ int DS_GetJoystickNumHats (int joystick)
  */
 int DS_GetJoystickNumAxes (int joystick)
 {
+    int count = 0;
+
+    pthread_mutex_lock (&store_mutex);
     if (joystick_exists (joystick))
-        return get_joystick (joystick)->num_axes;
+        count = store.num_axes [joystick];
+    pthread_mutex_unlock (&store_mutex);
 
-    return 0;
+    return count;
 }
 
 /**
@@ -134,10 +194,14 @@ int DS_GetJoystickNumAxes (int joystick)
  */
 int DS_GetJoystickNumButtons (int joystick)
 {
+    int count = 0;
+
+    pthread_mutex_lock (&store_mutex);
     if (joystick_exists (joystick))
-        return get_joystick (joystick)->num_buttons;
+        count = store.num_buttons [joystick];
+    pthread_mutex_unlock (&store_mutex);
 
-    return 0;
+    return count;
 }
 
 /**
@@ -150,14 +214,17 @@ int DS_GetJoystickNumButtons (int joystick)
  */
 int DS_GetJoystickHat (int joystick, int hat)
 {
-    if (CFG_GetRobotEnabled() && joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    int angle = 0;
 
-        if (stick->num_hats > hat)
-            return stick->hats [hat];
-    }
+    if (!CFG_GetRobotEnabled())
+        return 0;
+
+    pthread_mutex_lock (&store_mutex);
+    if (joystick_exists (joystick) && hat >= 0 && hat < store.num_hats [joystick])
+        angle = store.hats [joystick][hat];
+    pthread_mutex_unlock (&store_mutex);
 
-    return 0;
+    return angle;
 }
 
 /**
@@ -170,14 +237,17 @@ int DS_GetJoystickHat (int joystick, int hat)
  */
 float DS_GetJoystickAxis (int joystick, int axis)
 {
-    if (CFG_GetRobotEnabled() && joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    float value = 0;
 
-        if (stick->num_axes > axis)
-            return stick->axes [axis];
-    }
+    if (!CFG_GetRobotEnabled())
+        return 0;
+
+    pthread_mutex_lock (&store_mutex);
+    if (joystick_exists (joystick) && axis >= 0 && axis < store.num_axes [joystick])
+        value = store.axes [joystick][axis];
+    pthread_mutex_unlock (&store_mutex);
 
-    return 0;
+    return value;
 }
 
 /**
@@ -190,14 +260,49 @@ float DS_GetJoystickAxis (int joystick, int axis)
  */
 int DS_GetJoystickButton (int joystick, int button)
 {
-    if (CFG_GetRobotEnabled() && joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
+    int pressed = 0;
+
+    if (!CFG_GetRobotEnabled())
+        return 0;
+
+    pthread_mutex_lock (&store_mutex);
+    if (joystick_exists (joystick) && button >= 0 && button < store.num_buttons [joystick])
+        pressed = (int) ((store.buttons [joystick] >> button) & 1);
+    pthread_mutex_unlock (&store_mutex);
+
+    return pressed;
+}
+
+/**
+ * Copies the layout and values of every joystick into the given \a snapshot,
+ * this allows the protocols to generate the joystick data of all joysticks
+ * in a single pass.
+ *
+ * \note Regardless of protocol implementation, the joystick values will be
+ *       neutral if the robot is disabled. This is for additional safety!
+ */
+void DS_GetJoystickSnapshot (DS_JoystickSnapshot* snapshot)
+{
+    if (!snapshot)
+        return;
+
+    /* Copy the joystick store and the time of the inputs included in it */
+    pthread_mutex_lock (&store_mutex);
+    *snapshot = store;
+    if (input_time != 0) {
+        if (snapshot_time == 0)
+            snapshot_time = input_time;
 
-        if (stick->num_buttons > button)
-            return stick->buttons [button];
+        input_time = 0;
     }
+    pthread_mutex_unlock (&store_mutex);
 
-    return 0;
+    /* Neutralize the values if the robot is disabled */
+    if (!CFG_GetRobotEnabled()) {
+        memset (snapshot->axes, 0, sizeof (snapshot->axes));
+        memset (snapshot->hats, 0, sizeof (snapshot->hats));
+        memset (snapshot->buttons, 0, sizeof (snapshot->buttons));
+    }
 }
 
 /**
@@ -205,8 +310,9 @@ int DS_GetJoystickButton (int joystick, int button)
  */
 void DS_JoysticksReset (void)
 {
-    DS_ArrayFree (&array);
-    DS_ArrayInit (&array, 6);
+    pthread_mutex_lock (&store_mutex);
+    memset (&store, 0, sizeof (store));
+    pthread_mutex_unlock (&store_mutex);
 
     register_event();
 }
@@ -224,21 +330,23 @@ void DS_JoysticksAdd (const int axes, const int hats, const int buttons)
         return;
     }
 
-    /* Allocate memory for a new joystick */
-    DS_Joystick* joystick = (DS_Joystick*) calloc (1, sizeof (DS_Joystick));
-
-    /* Set joystick properties */
-    joystick->num_axes = axes;
-    joystick->num_hats = hats;
-    joystick->num_buttons = buttons;
+    /* Joystick store is full */
+    pthread_mutex_lock (&store_mutex);
+    if (store.count >= DS_MAX_JOYSTICKS) {
+        pthread_mutex_unlock (&store_mutex);
+        fprintf (stderr, "DS_JoystickAdd: Cannot register more joysticks!\n");
+        return;
+    }
 
-    /* Set joystick value arrays */
-    joystick->hats = calloc (hats, sizeof (int));
-    joystick->axes = calloc (axes, sizeof (float));
-    joystick->buttons = calloc (buttons, sizeof (int));
+    /* Set joystick properties (values are already neutral) */
+    int joystick = store.count;
+    store.num_axes [joystick] = limit_count (axes, DS_MAX_JOYSTICK_AXES, "axes");
+    store.num_hats [joystick] = limit_count (hats, DS_MAX_JOYSTICK_HATS, "hats");
+    store.num_buttons [joystick] = limit_count (buttons, DS_MAX_JOYSTICK_BUTTONS, "buttons");
 
-    /* Register the new joystick in the joystick list */
-    DS_ArrayInsert (&array, (void*) joystick);
+    /* Register the new joystick */
+    ++store.count;
+    pthread_mutex_unlock (&store_mutex);
 
     /* Emit the joystick count changed event */
     register_event();
@@ -249,12 +357,14 @@ void DS_JoysticksAdd (const int axes, const int hats, const int buttons)
  */
 void DS_SetJoystickHat (int joystick, int hat, int angle)
 {
-    if (joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
-
-        if (stick->num_hats > hat)
-            stick->hats [hat] = angle;
+    pthread_mutex_lock (&store_mutex);
+    if (joystick_exists (joystick) && hat >= 0 && hat < store.num_hats [joystick]) {
+        if (store.hats [joystick][hat] != (int16_t) angle) {
+            store.hats [joystick][hat] = (int16_t) angle;
+            mark_dirty (joystick);
+        }
     }
+    pthread_mutex_unlock (&store_mutex);
 }
 
 /**
@@ -262,12 +372,14 @@ void DS_SetJoystickHat (int joystick, int hat, int angle)
  */
 void DS_SetJoystickAxis (int joystick, int axis, float value)
 {
-    if (joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
-
-        if (stick->num_axes > axis)
-            stick->axes [axis] = value;
+    pthread_mutex_lock (&store_mutex);
+    if (joystick_exists (joystick) && axis >= 0 && axis < store.num_axes [joystick]) {
+        if (store.axes [joystick][axis] != value) {
+            store.axes [joystick][axis] = value;
+            mark_dirty (joystick);
+        }
     }
+    pthread_mutex_unlock (&store_mutex);
 }
 
 /**
@@ -275,10 +387,106 @@ void DS_SetJoystickAxis (int joystick, int axis, float value)
  */
 void DS_SetJoystickButton (int joystick, int button, int pressed)
 {
-    if (joystick_exists (joystick)) {
-        DS_Joystick* stick = get_joystick (joystick);
-
-        if (stick->num_buttons > button)
-            stick->buttons [button] = (pressed > 0) ? 1 : 0;
+    pthread_mutex_lock (&store_mutex);
+    if (joystick_exists (joystick) && button >= 0 && button < store.num_buttons [joystick]) {
+        uint64_t mask = ((uint64_t) 1) << button;
+        uint64_t state = (pressed > 0) ? mask : 0;
+
+        if ((store.buttons [joystick] & mask) != state) {
+            store.buttons [joystick] = (store.buttons [joystick] & ~mask) | state;
+            mark_dirty (joystick);
+        }
     }
+    pthread_mutex_unlock (&store_mutex);
+}
+
+/**
+ * Returns the time (in usecs) of the oldest joystick input that was copied
+ * into a snapshot and clears it, the protocol module calls this function
+ * after generating a robot packet. Returns \c 0 if the packet does not
+ * include new input.
+ */
+uint64_t Joysticks_TakeInputTime (void)
+{
+    pthread_mutex_lock (&store_mutex);
+    uint64_t time = snapshot_time;
+    snapshot_time = 0;
+    pthread_mutex_unlock (&store_mutex);
+
+    return time;
+}
+
+/**
+ * Registers that the input received at the given \a input_time has been sent
+ * to the robot, this function is called by the protocol module
+ */
+void Joysticks_InputSent (const uint64_t input_time)
+{
+    if (input_time == 0)
+        return;
+
+    uint64_t latency = DS_GetTimestamp() - input_time;
+
+    pthread_mutex_lock (&latency_mutex);
+    ++latency_samples;
+    last_latency = latency;
+    total_latency += latency;
+    if (latency > max_latency)
+        max_latency = latency;
+    pthread_mutex_unlock (&latency_mutex);
+}
+
+/**
+ * Clears the input-to-wire latency statistics
+ */
+void DS_ResetInputLatency (void)
+{
+    pthread_mutex_lock (&latency_mutex);
+    max_latency = 0;
+    last_latency = 0;
+    total_latency = 0;
+    latency_samples = 0;
+    pthread_mutex_unlock (&latency_mutex);
+}
+
+/**
+ * Returns the time (in milliseconds) between the last joystick input and
+ * the moment in which it was sent to the robot
+ */
+float DS_GetInputLatency (void)
+{
+    pthread_mutex_lock (&latency_mutex);
+    float latency = (float) last_latency / 1000;
+    pthread_mutex_unlock (&latency_mutex);
+
+    return latency;
+}
+
+/**
+ * Returns the highest input-to-wire latency (in milliseconds) since the
+ * statistics were reset
+ */
+float DS_GetMaxInputLatency (void)
+{
+    pthread_mutex_lock (&latency_mutex);
+    float latency = (float) max_latency / 1000;
+    pthread_mutex_unlock (&latency_mutex);
+
+    return latency;
+}
+
+/**
+ * Returns the average input-to-wire latency (in milliseconds) since the
+ * statistics were reset
+ */
+float DS_GetAverageInputLatency (void)
+{
+    float latency = 0;
+
+    pthread_mutex_lock (&latency_mutex);
+    if (latency_samples > 0)
+        latency = ((float) total_latency / latency_samples) / 1000;
+    pthread_mutex_unlock (&latency_mutex);
+
+    return latency;
 }
@@ -0,0 +1,586 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Links.h"
+#include "DS_Timer.h"
+#include "DS_Utils.h"
+
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * Number of sent/received sequence numbers remembered by each link
+ */
+#define RING_SIZE 256
+
+/*
+ * The latency histogram uses 16 linear sub-buckets for every power of two,
+ * so that every recorded value is stored with a precision of ~6%
+ */
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+
+/*
+ * Packet loss is accounted in time slots of 100 ms, covering the last 10 s
+ */
+#define SLOT_USECS 100000
+#define SLOT_COUNT 100
+
+/*
+ * If nothing is received during this time, the packets sent since the last
+ * reply are accounted as lost (until the link recovers and the gap in the
+ * sequence numbers can be measured)
+ */
+#define SILENCE_USECS 1000000
+
+/*
+ * Number of links tracked by this module
+ */
+#define LINK_COUNT 3
+
+/*
+ * Holds the packet counters of a time slot
+ */
+typedef struct {
+    uint64_t index;
+    unsigned long sent;
+    unsigned long expected;
+    unsigned long received;
+} Slot;
+
+/*
+ * Holds the statistics of a network link, times are stored in microseconds
+ */
+typedef struct {
+    int numbered;
+    Slot total;
+    Slot slots [SLOT_COUNT];
+
+    int sends_tracked;
+    uint16_t sent_sequence [RING_SIZE];
+    uint64_t sent_time [RING_SIZE];
+    uint8_t sent_pending [RING_SIZE];
+    int32_t recv_sequence [RING_SIZE];
+
+    int highest;
+    double jitter;
+    int64_t last_delay;
+    uint64_t last_arrival;
+
+    uint64_t min_rtt;
+    uint64_t max_rtt;
+    uint64_t total_rtt;
+    unsigned long samples;
+    unsigned long unmatched;
+    unsigned long dropped;
+    unsigned long duplicates;
+    unsigned long out_of_order;
+    unsigned long histogram [DS_LATENCY_BUCKETS];
+} Link;
+
+/*
+ * The links are updated by the protocol thread and read by the client
+ */
+static Link links [LINK_COUNT];
+static pthread_mutex_t mutex;
+
+/**
+ * Returns the statistics of the given \a link, or \c NULL if \a link is invalid
+ */
+static Link* get_link (const DS_Link link)
+{
+    if ((int) link >= 0 && (int) link < LINK_COUNT)
+        return &links [link];
+
+    return NULL;
+}
+
+/**
+ * Returns the histogram bucket that holds the given \a value
+ */
+static int bucket_index (const uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return (int) value;
+
+    /* Get the position of the most significant bit */
+    int msb = 0;
+    uint64_t bits = value;
+    while (bits >>= 1)
+        ++msb;
+
+    /* Use the next bits to find the linear sub-bucket */
+    int shift = msb - SUB_BUCKET_BITS;
+    int index = (shift + 1) * SUB_BUCKETS + (int) ((value >> shift) - SUB_BUCKETS);
+
+    return DS_Min (index, DS_LATENCY_BUCKETS - 1);
+}
+
+/**
+ * Returns the highest value (in microseconds) stored by the given \a bucket
+ */
+static uint64_t bucket_limit (const int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return (uint64_t) bucket;
+
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t base = (uint64_t) (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return base + ((uint64_t) 1 << shift) - 1;
+}
+
+/**
+ * Returns the round-trip time (in milliseconds) below which the given
+ * \a percentile of the samples of the \a ptr link are found
+ */
+static float get_percentile (const Link* ptr, const float percentile)
+{
+    if (ptr->samples == 0)
+        return 0;
+
+    /* Get the number of samples to walk through */
+    float target = ((float) ptr->samples * percentile) / 100;
+    unsigned long count = (unsigned long) target;
+    if ((float) count < target)
+        ++count;
+    if (count < 1)
+        count = 1;
+
+    /* Find the bucket that holds the target sample */
+    int bucket;
+    unsigned long total = 0;
+    for (bucket = 0; bucket < DS_LATENCY_BUCKETS - 1; ++bucket) {
+        total += ptr->histogram [bucket];
+        if (total >= count)
+            break;
+    }
+
+    /* The bucket may be wider than the observed values */
+    uint64_t value = bucket_limit (bucket);
+    if (value > ptr->max_rtt)
+        value = ptr->max_rtt;
+
+    return (float) value / 1000;
+}
+
+/**
+ * Returns the time slot of the \a ptr link that corresponds to the given
+ * monotonic time \a now, the slot is cleared if it held older data
+ */
+static Slot* get_slot (Link* ptr, const uint64_t now)
+{
+    uint64_t index = now / SLOT_USECS;
+    Slot* slot = &ptr->slots [index % SLOT_COUNT];
+
+    if (slot->index != index) {
+        memset (slot, 0, sizeof (Slot));
+        slot->index = index;
+    }
+
+    return slot;
+}
+
+/**
+ * Registers the given number of sent, expected and received packets in the
+ * current time slot and in the totals of the \a ptr link
+ */
+static void count_packets (Link* ptr, const uint64_t now,
+                           const unsigned long sent,
+                           const unsigned long expected,
+                           const unsigned long received)
+{
+    Slot* slot = get_slot (ptr, now);
+
+    slot->sent += sent;
+    slot->expected += expected;
+    slot->received += received;
+
+    ptr->total.sent += sent;
+    ptr->total.expected += expected;
+    ptr->total.received += received;
+}
+
+/**
+ * Returns the number of packets lost in the given \a counters
+ *
+ * If the link has sequence numbers, the expected packets are the ones that
+ * the received sequence numbers account for (including the gaps). Otherwise,
+ * every sent packet is expected to produce a reply.
+ */
+static unsigned long lost_packets (const Link* ptr, const Slot* counters)
+{
+    unsigned long expected = counters->expected;
+    if (!ptr->numbered || counters->received == 0)
+        expected = counters->sent;
+
+    if (counters->received >= expected)
+        return 0;
+
+    return expected - counters->received;
+}
+
+/**
+ * Returns the packet loss percentage of the given \a counters
+ */
+static float loss_percentage (const Link* ptr, const Slot* counters)
+{
+    unsigned long lost = lost_packets (ptr, counters);
+    if (lost == 0)
+        return 0;
+
+    return (100.0f * lost) / (float) (lost + counters->received);
+}
+
+/**
+ * Returns the packet loss percentage of the \a ptr link during the last
+ * \a count time slots (including the current one)
+ */
+static float window_loss (const Link* ptr, const uint64_t now, const int count)
+{
+    Slot sum;
+    memset (&sum, 0, sizeof (Slot));
+
+    /* Check if the link went silent */
+    int silent = ptr->numbered && now - ptr->last_arrival > SILENCE_USECS;
+    uint64_t last_reply = ptr->last_arrival / SLOT_USECS;
+
+    int i;
+    unsigned long unanswered = 0;
+    uint64_t index = now / SLOT_USECS;
+    for (i = 0; i < SLOT_COUNT; ++i) {
+        const Slot* slot = &ptr->slots [i];
+        if (slot->index <= index && slot->index + (uint64_t) count > index) {
+            sum.sent += slot->sent;
+            sum.expected += slot->expected;
+            sum.received += slot->received;
+
+            if (silent && slot->index > last_reply)
+                unanswered += slot->sent;
+        }
+    }
+
+    /* Add the packets that were not answered during the silence */
+    if (sum.received > 0)
+        sum.expected += unanswered;
+
+    return loss_percentage (ptr, &sum);
+}
+
+/**
+ * Clears the statistics of the given \a link
+ */
+static void reset_link (Link* ptr)
+{
+    memset (ptr, 0, sizeof (Link));
+
+    int i;
+    for (i = 0; i < RING_SIZE; ++i)
+        ptr->recv_sequence [i] = -1;
+
+    ptr->highest = -1;
+    ptr->last_delay = -1;
+}
+
+/**
+ * Adds the given round-trip time \a rtt to the statistics of the \a ptr link
+ */
+static void record_rtt (Link* ptr, const uint64_t rtt)
+{
+    if (ptr->samples == 0 || rtt < ptr->min_rtt)
+        ptr->min_rtt = rtt;
+    if (rtt > ptr->max_rtt)
+        ptr->max_rtt = rtt;
+
+    ++ptr->samples;
+    ptr->total_rtt += rtt;
+    ++ptr->histogram [bucket_index (rtt)];
+}
+
+/**
+ * Initializes the link statistics module
+ */
+void Links_Init (void)
+{
+    int i;
+    for (i = 0; i < LINK_COUNT; ++i)
+        reset_link (&links [i]);
+
+    pthread_mutex_init (&mutex, NULL);
+}
+
+/**
+ * De-initializes the link statistics module
+ */
+void Links_Close (void)
+{
+    pthread_mutex_destroy (&mutex);
+}
+
+/**
+ * Registers that a packet with the given \a sequence number has been sent
+ * through the given \a link. If \a sequence is negative (e.g. the protocol
+ * does not number its packets), the packet is only counted.
+ */
+void Links_PacketSent (const DS_Link link, const int sequence)
+{
+    Link* ptr = get_link (link);
+    if (!ptr)
+        return;
+
+    uint64_t now = DS_GetTimestamp();
+    int slot = sequence & (RING_SIZE - 1);
+
+    pthread_mutex_lock (&mutex);
+    count_packets (ptr, now, 1, 0, 0);
+
+    /* Packet is not numbered */
+    if (sequence < 0) {
+        pthread_mutex_unlock (&mutex);
+        return;
+    }
+
+    ptr->sends_tracked = 1;
+    ptr->sent_pending [slot] = 1;
+    ptr->sent_time [slot] = now;
+    ptr->sent_sequence [slot] = (uint16_t) sequence;
+    pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Registers that a packet with the given \a sequence number has been received
+ * through the given \a link.
+ *
+ * Gaps in the received sequence numbers are accounted as lost packets, if a
+ * missing packet arrives later, it is accounted as received again. If the
+ * \a sequence is negative, the packet is only counted.
+ *
+ * If the sequence number matches a recently sent packet (e.g. the robot echoes
+ * the number of the last packet that it received), the round-trip time is
+ * added to the histogram and the jitter is updated with the variation of the
+ * round-trip time. Otherwise, the jitter is calculated from the variation of
+ * the time between received packets.
+ */
+void Links_PacketReceived (const DS_Link link, const int sequence)
+{
+    Link* ptr = get_link (link);
+    if (!ptr)
+        return;
+
+    uint64_t now = DS_GetTimestamp();
+    int slot = sequence & (RING_SIZE - 1);
+
+    pthread_mutex_lock (&mutex);
+
+    /* Packet is not numbered */
+    if (sequence < 0) {
+        count_packets (ptr, now, 0, 1, 1);
+        pthread_mutex_unlock (&mutex);
+        return;
+    }
+
+    /* Packet was already received */
+    if (ptr->recv_sequence [slot] == sequence) {
+        ++ptr->duplicates;
+        pthread_mutex_unlock (&mutex);
+        return;
+    }
+
+    /* Check if the packet is newer than the previous ones */
+    unsigned long expected = 1;
+    ptr->recv_sequence [slot] = sequence;
+    if (ptr->highest >= 0) {
+        int16_t delta = (int16_t) (sequence - ptr->highest);
+
+        /* Packets between the previous and this one were lost */
+        if (delta > 0) {
+            expected = (unsigned long) delta;
+            ptr->highest = sequence;
+        }
+
+        /* Sender restarted its sequence */
+        else if (delta < -RING_SIZE)
+            ptr->highest = sequence;
+
+        /* Packet was accounted as lost */
+        else {
+            expected = 0;
+            ++ptr->out_of_order;
+        }
+    }
+
+    else
+        ptr->highest = sequence;
+
+    /* Update packet loss counters */
+    ptr->numbered = 1;
+    count_packets (ptr, now, 0, expected, 1);
+
+    /* Match the packet with the sent packet */
+    int64_t delay = -1;
+    if (ptr->sent_pending [slot] && ptr->sent_sequence [slot] == sequence) {
+        delay = (int64_t) (now - ptr->sent_time [slot]);
+        ptr->sent_pending [slot] = 0;
+        record_rtt (ptr, (uint64_t) delay);
+    }
+
+    /* Reply does not belong to any recent packet */
+    else if (ptr->sends_tracked)
+        ++ptr->unmatched;
+
+    /* Use the inter-arrival time instead */
+    else if (ptr->last_arrival > 0)
+        delay = (int64_t) (now - ptr->last_arrival);
+
+    /* Update the jitter (as in RFC 3550) */
+    if (delay >= 0) {
+        if (ptr->last_delay >= 0) {
+            int64_t diff = delay - ptr->last_delay;
+            if (diff < 0)
+                diff = -diff;
+
+            ptr->jitter += ((double) diff - ptr->jitter) / 16;
+        }
+
+        ptr->last_delay = delay;
+    }
+
+    ptr->last_arrival = now;
+    pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Registers that the socket of the given \a link discarded \a count received
+ * packets because the protocol did not read them in time
+ */
+void Links_PacketsDropped (const DS_Link link, const unsigned long count)
+{
+    Link* ptr = get_link (link);
+    if (!ptr || count == 0)
+        return;
+
+    pthread_mutex_lock (&mutex);
+    ptr->dropped += count;
+    pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Clears the latency and packet loss statistics of the given \a link
+ */
+void DS_ResetLinkStats (const DS_Link link)
+{
+    Link* ptr = get_link (link);
+    if (!ptr)
+        return;
+
+    pthread_mutex_lock (&mutex);
+    reset_link (ptr);
+    pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Copies the latency and packet loss statistics of the given \a link
+ * into \a stats
+ */
+void DS_GetLinkStats (const DS_Link link, DS_LinkStats* stats)
+{
+    Link* ptr = get_link (link);
+    if (!ptr || !stats)
+        return;
+
+    uint64_t now = DS_GetTimestamp();
+    pthread_mutex_lock (&mutex);
+
+    stats->samples = ptr->samples;
+    stats->dropped = ptr->dropped;
+    stats->unmatched = ptr->unmatched;
+    stats->duplicates = ptr->duplicates;
+    stats->out_of_order = ptr->out_of_order;
+    stats->min_rtt = (float) ptr->min_rtt / 1000;
+    stats->max_rtt = (float) ptr->max_rtt / 1000;
+    stats->jitter = (float) ptr->jitter / 1000;
+    stats->p50_rtt = get_percentile (ptr, 50);
+    stats->p95_rtt = get_percentile (ptr, 95);
+    stats->p99_rtt = get_percentile (ptr, 99);
+    stats->lost = lost_packets (ptr, &ptr->total);
+    stats->loss_total = loss_percentage (ptr, &ptr->total);
+    stats->loss_1s = window_loss (ptr, now, 1000000 / SLOT_USECS);
+    stats->loss_10s = window_loss (ptr, now, SLOT_COUNT);
+
+    if (ptr->samples > 0)
+        stats->mean_rtt = ((float) ptr->total_rtt / ptr->samples) / 1000;
+    else
+        stats->mean_rtt = 0;
+
+    pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Returns the round-trip time (in milliseconds) below which the given
+ * \a percentile (0 to 100) of the samples of the \a link are found
+ */
+float DS_GetLatencyPercentile (const DS_Link link, const float percentile)
+{
+    Link* ptr = get_link (link);
+    if (!ptr)
+        return 0;
+
+    pthread_mutex_lock (&mutex);
+    float value = get_percentile (ptr, percentile);
+    pthread_mutex_unlock (&mutex);
+
+    return value;
+}
+
+/**
+ * Copies up to \a size buckets of the round-trip time histogram of the given
+ * \a link into \a counts. Use \c DS_GetLatencyBucketLimit() to obtain the
+ * round-trip time represented by each bucket.
+ *
+ * \returns the number of copied buckets
+ */
+int DS_GetLatencyHistogram (const DS_Link link, unsigned long* counts, const int size)
+{
+    Link* ptr = get_link (link);
+    if (!ptr || !counts || size <= 0)
+        return 0;
+
+    int buckets = DS_Min (size, DS_LATENCY_BUCKETS);
+
+    pthread_mutex_lock (&mutex);
+    memcpy (counts, ptr->histogram, sizeof (unsigned long) * (size_t) buckets);
+    pthread_mutex_unlock (&mutex);
+
+    return buckets;
+}
+
+/**
+ * Returns the highest round-trip time (in milliseconds) stored by the given
+ * histogram \a bucket
+ */
+float DS_GetLatencyBucketLimit (const int bucket)
+{
+    if (bucket < 0 || bucket >= DS_LATENCY_BUCKETS)
+        return 0;
+
+    return (float) bucket_limit (bucket) / 1000;
+}
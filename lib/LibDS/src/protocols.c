@@ -25,9 +25,11 @@
 #include "DS_Timer.h"
 #include "DS_Client.h"
 #include "DS_Config.h"
+#include "DS_Links.h"
 #include "DS_Events.h"
 #include "DS_Socket.h"
 #include "DS_Protocol.h"
+#include "DS_Joysticks.h"
 
 #include <stdio.h>
 #include <assert.h>
@@ -71,7 +73,7 @@ static int radio_read = 0;
 static int robot_read = 0;
 
 /*
- * Holds the received data
+ * Views of the received data, the buffers are owned by the sockets
  */
 static DS_String fms_data;
 static DS_String radio_data;
@@ -98,50 +100,209 @@ static unsigned long recv_radio_bytes = 0;
 static unsigned long sent_robot_bytes = 0;
 static unsigned long recv_robot_bytes = 0;
 
+/*
+ * Packet buffers (one per socket), reused for every sent packet
+ */
+static uint8_t fms_packet [DS_SOCKET_BUFFER_SIZE];
+static uint8_t radio_packet [DS_SOCKET_BUFFER_SIZE];
+static uint8_t robot_packet [DS_SOCKET_BUFFER_SIZE];
+
+/*
+ * Holds the information needed to register a sent packet once the sockets
+ * module reports the number of bytes that were actually sent
+ */
+typedef struct {
+    DS_Link link;          /* Link used to send the packet */
+    int sequence;          /* Sequence number of the packet (-1 if none) */
+    uint64_t input_time;   /* Time of the joystick input included in it */
+    unsigned long* bytes;  /* Sent bytes counter of the link */
+} SentPacket;
+
+static SentPacket fms_sent = { DS_LINK_FMS, -1, 0, &sent_fms_bytes };
+static SentPacket radio_sent = { DS_LINK_RADIO, -1, 0, &sent_radio_bytes };
+static SentPacket robot_sent = { DS_LINK_ROBOT, -1, 0, &sent_robot_bytes };
+
 /*
  * The thread ID for the protocol event loop
  */
 static pthread_t event_thread;
 
+/*
+ * Used to wake up the event loop when a timer expires or data is received
+ */
+static int wakeup_pending = 0;
+static pthread_cond_t wakeup_cond;
+static pthread_mutex_t wakeup_mutex;
+
+/*
+ * Held by the event loop while it uses the protocol, so that the protocol
+ * (and its sockets) is never closed or replaced during an iteration
+ */
+static pthread_mutex_t protocol_mutex;
+
+/**
+ * Wakes up the event loop, this function is called by the timer scheduler
+ * and the socket threads
+ */
+static void wakeup_event_loop (void)
+{
+    pthread_mutex_lock (&wakeup_mutex);
+    wakeup_pending = 1;
+    pthread_cond_signal (&wakeup_cond);
+    pthread_mutex_unlock (&wakeup_mutex);
+}
+
+/**
+ * Blocks the event loop until a timer expires, a socket receives data
+ * or the module is closed
+ */
+static void wait_for_events (void)
+{
+    pthread_mutex_lock (&wakeup_mutex);
+    while (running && !wakeup_pending)
+        pthread_cond_wait (&wakeup_cond, &wakeup_mutex);
+
+    wakeup_pending = 0;
+    pthread_mutex_unlock (&wakeup_mutex);
+}
+
+/**
+ * Returns the sequence number of the given packet using the \a sequence
+ * function of the protocol, or \c -1 if the protocol does not implement it
+ */
+static int get_sequence (int (*sequence) (const uint8_t*, const size_t, const int),
+                         const uint8_t* data, const size_t len, const int sent)
+{
+    if (sequence && data)
+        return sequence (data, len, sent);
+
+    return -1;
+}
+
+/**
+ * Registers the sequence number of a packet received through the \a link
+ */
+static void track_received (const DS_Link link,
+                            int (*sequence) (const uint8_t*, const size_t, const int),
+                            const DS_String* data)
+{
+    Links_PacketReceived (link, get_sequence (sequence,
+                                              (const uint8_t*) data->buf,
+                                              DS_StrLen (data), 0));
+}
+
+/**
+ * Called by the sockets module once a packet has been sent (or has failed),
+ * updates the sent bytes, the link statistics and the input latency
+ */
+static void packet_sent (void* data, const int bytes)
+{
+    SentPacket* packet = (SentPacket*) data;
+
+    if (bytes > 0) {
+        *packet->bytes += bytes;
+        Links_PacketSent (packet->link, packet->sequence);
+
+        if (packet->link == DS_LINK_ROBOT)
+            Joysticks_InputSent (packet->input_time);
+    }
+}
+
+/**
+ * Returns the time of the joystick input that the protocol included in the
+ * packet that was just generated (robot packets only)
+ */
+static uint64_t get_input_time (const SentPacket* packet)
+{
+    if (packet->link == DS_LINK_ROBOT)
+        return Joysticks_TakeInputTime();
+
+    return 0;
+}
+
+/**
+ * Generates a new packet and sends it through the given \a socket.
+ *
+ * If the protocol implements the \a build function, the packet is written
+ * directly into the given \a storage (so no memory is allocated), otherwise,
+ * the packet is generated with the \a create function.
+ *
+ * The packet may be sent when the current batch is flushed, the statistics
+ * of the link are updated once the sockets module reports the result.
+ */
+static void send_packet (DS_Socket* socket, SentPacket* packet,
+                         int (*build) (DS_Buffer*),
+                         DS_String (*create) (void),
+                         int (*sequence) (const uint8_t*, const size_t, const int),
+                         uint8_t* storage, const size_t size)
+{
+    /* Write the packet into the preallocated buffer */
+    if (build) {
+        DS_Buffer buffer;
+        DS_BufferInit (&buffer, storage, size);
+
+        if (build (&buffer)) {
+            packet->sequence = get_sequence (sequence, buffer.data, buffer.len, 1);
+            packet->input_time = get_input_time (packet);
+            DS_SocketQueueBytes (socket, buffer.data, (int) buffer.len,
+                                 &packet_sent, packet);
+        }
+    }
+
+    /* Generate a new packet string (the data is copied if it is queued) */
+    else if (create) {
+        DS_String data = create();
+        packet->sequence = get_sequence (sequence, (const uint8_t*) data.buf,
+                                         DS_StrLen (&data), 1);
+        packet->input_time = get_input_time (packet);
+        DS_SocketQueueBytes (socket, data.buf, (int) DS_StrLen (&data),
+                             &packet_sent, packet);
+        DS_StrRmBuf (&data);
+    }
+}
+
 /**
- * Sends a new packet to the FMS, the generated data is immediatly deleted
- * once the packet has been sent
+ * Sends a new packet to the FMS
  */
 static void send_fms_data()
 {
     if (enable_operations) {
         ++sent_fms_packets;
-        DS_String data = protocol.create_fms_packet();
-        sent_fms_bytes += DS_Max (DS_SocketSend (&protocol.fms_socket, &data), 0);
-        DS_StrRmBuf (&data);
+        send_packet (&protocol.fms_socket, &fms_sent,
+                     protocol.build_fms_packet,
+                     protocol.create_fms_packet,
+                     protocol.fms_sequence,
+                     fms_packet, sizeof (fms_packet));
     }
 }
 
 /**
- * Sends a new packet to the radio, the generated data is immediatly deleted
- * once the packet has been sent
+ * Sends a new packet to the radio
  */
 static void send_radio_data()
 {
     if (enable_operations) {
         ++sent_radio_packets;
-        DS_String data = protocol.create_radio_packet();
-        sent_radio_bytes += DS_Max (DS_SocketSend (&protocol.radio_socket, &data), 0);
-        DS_StrRmBuf (&data);
+        send_packet (&protocol.radio_socket, &radio_sent,
+                     protocol.build_radio_packet,
+                     protocol.create_radio_packet,
+                     protocol.radio_sequence,
+                     radio_packet, sizeof (radio_packet));
     }
 }
 
 /**
- * Sends a new packet to the robot, the generated data is immediatly deleted
- * once the packet has been sent
+ * Sends a new packet to the robot
  */
 static void send_robot_data()
 {
     if (enable_operations) {
         ++sent_robot_packets;
-        DS_String data = protocol.create_robot_packet();
-        sent_robot_bytes += DS_Max (DS_SocketSend (&protocol.robot_socket, &data), 0);
-        DS_StrRmBuf (&data);
+        send_packet (&protocol.robot_socket, &robot_sent,
+                     protocol.build_robot_packet,
+                     protocol.create_robot_packet,
+                     protocol.robot_sequence,
+                     robot_packet, sizeof (robot_packet));
     }
 }
 
@@ -155,84 +316,144 @@ static void send_data()
     if (!enable_operations)
         return;
 
+    /* Send every packet that is due with a single system call */
+    DS_SocketBatchBegin();
+
     /* Send FMS packet */
     if (fms_send_timer.expired) {
         send_fms_data();
-        DS_TimerReset (&fms_send_timer);
+        DS_TimerAdvance (&fms_send_timer);
     }
 
     /* Send radio packet */
     if (radio_send_timer.expired) {
         send_radio_data();
-        DS_TimerReset (&radio_send_timer);
+        DS_TimerAdvance (&radio_send_timer);
     }
 
     /* Send robot packet */
     if (robot_send_timer.expired) {
         send_robot_data();
-        DS_TimerReset (&robot_send_timer);
+        DS_TimerAdvance (&robot_send_timer);
     }
+
+    /* Send the queued packets */
+    DS_SocketBatchFlush();
 }
 
 /**
- * Clears the strings that hold the incoming data packets
+ * Clears the views of the incoming data packets
  */
 static void clear_recv_data()
 {
-    DS_StrRmBuf (&fms_data);
-    DS_StrRmBuf (&radio_data);
-    DS_StrRmBuf (&robot_data);
-    DS_StrRmBuf (&netcs_data);
+    memset (&fms_data, 0, sizeof (fms_data));
+    memset (&radio_data, 0, sizeof (radio_data));
+    memset (&robot_data, 0, sizeof (robot_data));
+    memset (&netcs_data, 0, sizeof (netcs_data));
 }
 
 /**
- * Reads the received data using the functions provided by the current protocol.
- * If there is no protocol running, then this function will do nothing.
+ * Reads every packet received from the FMS since the last call
  */
-static void recv_data()
+static void read_fms_data()
 {
-    /* Protocol is NULL, abort */
-    if (!enable_operations)
-        return;
-
-    /* Clear buffers (just to be sure) */
-    clear_recv_data();
-
-    /* Read data from sockets */
-    fms_data = DS_SocketRead (&protocol.fms_socket);
-    radio_data = DS_SocketRead (&protocol.radio_socket);
-    robot_data = DS_SocketRead (&protocol.robot_socket);
-    netcs_data = DS_SocketRead (&protocol.netconsole_socket);
-
-    /* Update received data indicators */
-    recv_fms_bytes += DS_StrLen (&fms_data);
-    recv_radio_bytes += DS_StrLen (&radio_data);
-    recv_robot_bytes += DS_StrLen (&robot_data);
-
-    /* Read FMS packet */
-    if (DS_StrLen (&fms_data) > 0) {
+    while (DS_SocketReadView (&protocol.fms_socket, &fms_data)) {
         ++received_fms_packets;
-        fms_read = protocol.read_fms_packet (&fms_data);
-        CFG_SetFMSCommunications (fms_read);
+        recv_fms_bytes += DS_StrLen (&fms_data);
+
+        /* Publish the state once the packet is interpreted */
+        CFG_BeginUpdate();
+        int success = protocol.read_fms_packet (&fms_data);
+        CFG_SetFMSCommunications (success);
+        CFG_EndUpdate();
+        fms_read |= success;
+
+        /* Update the link statistics */
+        if (success)
+            track_received (DS_LINK_FMS, protocol.fms_sequence, &fms_data);
     }
 
-    /* Read radio packet */
-    if (DS_StrLen (&radio_data) > 0) {
+    /* Count the packets that the socket discarded */
+    Links_PacketsDropped (DS_LINK_FMS, DS_SocketTakeDropped (&protocol.fms_socket));
+}
+
+/**
+ * Reads every packet received from the radio since the last call
+ */
+static void read_radio_data()
+{
+    while (DS_SocketReadView (&protocol.radio_socket, &radio_data)) {
         ++received_radio_packets;
-        radio_read = protocol.read_radio_packet (&radio_data);
-        CFG_SetRadioCommunications (radio_read);
+        recv_radio_bytes += DS_StrLen (&radio_data);
+
+        /* Publish the state once the packet is interpreted */
+        CFG_BeginUpdate();
+        int success = protocol.read_radio_packet (&radio_data);
+        CFG_SetRadioCommunications (success);
+        CFG_EndUpdate();
+        radio_read |= success;
+
+        /* Update the link statistics */
+        if (success)
+            track_received (DS_LINK_RADIO, protocol.radio_sequence, &radio_data);
     }
 
-    /* Read robot packet */
-    if (DS_StrLen (&robot_data) > 0) {
+    /* Count the packets that the socket discarded */
+    Links_PacketsDropped (DS_LINK_RADIO, DS_SocketTakeDropped (&protocol.radio_socket));
+}
+
+/**
+ * Reads every packet received from the robot since the last call
+ */
+static void read_robot_data()
+{
+    while (DS_SocketReadView (&protocol.robot_socket, &robot_data)) {
         ++received_robot_packets;
-        robot_read = protocol.read_robot_packet (&robot_data);
-        CFG_SetRobotCommunications (robot_read);
+        recv_robot_bytes += DS_StrLen (&robot_data);
+
+        /* Publish the state once the packet is interpreted */
+        CFG_BeginUpdate();
+        int success = protocol.read_robot_packet (&robot_data);
+        CFG_SetRobotCommunications (success);
+        CFG_EndUpdate();
+        robot_read |= success;
+
+        /* Update the link statistics */
+        if (success)
+            track_received (DS_LINK_ROBOT, protocol.robot_sequence, &robot_data);
     }
 
-    /* Add NetConsole message to event system */
-    if (netcs_data.len > 0)
+    /* Count the packets that the socket discarded */
+    Links_PacketsDropped (DS_LINK_ROBOT, DS_SocketTakeDropped (&protocol.robot_socket));
+}
+
+/**
+ * Adds every received NetConsole message to the event system
+ */
+static void read_netconsole_data()
+{
+    while (DS_SocketReadView (&protocol.netconsole_socket, &netcs_data))
         CFG_AddNetConsoleMessage (&netcs_data);
+}
+
+/**
+ * Reads the received data using the functions provided by the current protocol.
+ * If there is no protocol running, then this function will do nothing.
+ */
+static void recv_data()
+{
+    /* Protocol is NULL, abort */
+    if (!enable_operations)
+        return;
+
+    /* Clear buffers (just to be sure) */
+    clear_recv_data();
+
+    /* Read all the received packets */
+    read_fms_data();
+    read_radio_data();
+    read_robot_data();
+    read_netconsole_data();
 
     /* Reset the data pointers */
     clear_recv_data();
@@ -273,19 +494,26 @@ static void update_watchdogs()
 }
 
 /**
- * This function is executed periodically, the function does the following:
+ * This function is executed every time that a timer expires or that a socket
+ * receives data, the function does the following:
  *    - Send data to the FMS, robot and radio
  *    - Read received data from the FMS, robot and radio
  *    - Feed/reset the watchdogs
  *    - Check if any of the watchdogs has expired
+ *
+ * Between iterations, the thread sleeps until the earliest send deadline
+ * is reached or until a socket becomes readable (whichever comes first)
  */
 static void* run_event_loop()
 {
     while (running) {
+        pthread_mutex_lock (&protocol_mutex);
         send_data();
         recv_data();
         update_watchdogs();
-        DS_Sleep (5);
+        pthread_mutex_unlock (&protocol_mutex);
+
+        wait_for_events();
     }
 
     return NULL;
@@ -317,8 +545,23 @@ void Protocols_Init()
     DS_TimerInit (&radio_recv_timer, 0, RECV_PRECISION);
     DS_TimerInit (&robot_recv_timer, 0, RECV_PRECISION);
 
+    /* Wake up the event loop when a timer expires */
+    fms_send_timer.callback = &wakeup_event_loop;
+    radio_send_timer.callback = &wakeup_event_loop;
+    robot_send_timer.callback = &wakeup_event_loop;
+    fms_recv_timer.callback = &wakeup_event_loop;
+    radio_recv_timer.callback = &wakeup_event_loop;
+    robot_recv_timer.callback = &wakeup_event_loop;
+
+    /* Wake up the event loop when data is received */
+    pthread_cond_init (&wakeup_cond, NULL);
+    pthread_mutex_init (&wakeup_mutex, NULL);
+    pthread_mutex_init (&protocol_mutex, NULL);
+    DS_SocketSetReadyCallback (&wakeup_event_loop);
+
     /* Allow the event loop to run */
     running = 1;
+    wakeup_pending = 0;
     enable_operations = 0;
 
     /* Configure the event thread */
@@ -374,10 +617,15 @@ static void close_protocol()
     sent_robot_bytes = 0;
     recv_robot_bytes = 0;
 
+    /* Reset latency and packet loss statistics */
+    DS_ResetLinkStats (DS_LINK_FMS);
+    DS_ResetLinkStats (DS_LINK_RADIO);
+    DS_ResetLinkStats (DS_LINK_ROBOT);
+
     /* Reset sent/recv packets */
     DS_ResetFMSPackets();
     DS_ResetRadioPackets();
-    DS_ResetRadioPackets();
+    DS_ResetRobotPackets();
 
     /* Create notification string */
     char* name = DS_StrToChar (&protocol.name);
@@ -392,9 +640,24 @@ static void close_protocol()
  */
 void Protocols_Close()
 {
+    /* Stop the event loop and wait for it to finish */
+    pthread_mutex_lock (&wakeup_mutex);
     running = 0;
+    pthread_cond_signal (&wakeup_cond);
+    pthread_mutex_unlock (&wakeup_mutex);
+    pthread_join (event_thread, NULL);
+
+    /* Stop receiving notifications (waits for a running notification) */
+    DS_SocketSetReadyCallback (NULL);
+
+    /* Close the protocol (stopping its timers waits for their callbacks) */
     close_protocol();
     clear_recv_data();
+
+    /* Delete the synchronization objects, no callback can use them now */
+    pthread_cond_destroy (&wakeup_cond);
+    pthread_mutex_destroy (&wakeup_mutex);
+    pthread_mutex_destroy (&protocol_mutex);
 }
 
 /**
@@ -410,6 +673,9 @@ void DS_ConfigureProtocol (const DS_Protocol* ptr)
     /* Pointer is NULL, abort */
     assert (ptr != NULL);
 
+    /* Wait until the event loop is not using the current protocol */
+    pthread_mutex_lock (&protocol_mutex);
+
     /* Close previous protocol */
     close_protocol();
 
@@ -449,6 +715,7 @@ void DS_ConfigureProtocol (const DS_Protocol* ptr)
 
     /* Restore protocol operations */
     enable_operations = 1;
+    pthread_mutex_unlock (&protocol_mutex);
 }
 
 /**
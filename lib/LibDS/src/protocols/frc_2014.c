@@ -194,8 +194,8 @@ static uint8_t get_digital_inputs (void)
 }
 
 /**
- * Adds joystick information to a DS-to-robot packet, beginning at the given
- * \a offset in the data packet.
+ * Adds joystick information to a DS-to-robot packet, at the end of the
+ * given \a buffer.
  *
  * The 2014 communication protocol records the data for all four joysticks,
  * if a joystick or joystick member is not present, we will send a neutral
@@ -207,30 +207,31 @@ static uint8_t get_digital_inputs (void)
  * Button states are stored in a similar way as enumerated flags in a C/C++
  * program.
  */
-static DS_String get_joystick_data (void)
+static void add_joystick_data (DS_Buffer* buffer)
 {
     /* Initialize variables */
     int i = 0;
-    int j = 0;
-    DS_String buf = DS_StrNewLen (0);
+
+    /* Get the joystick values (missing joysticks have neutral values) */
+    DS_JoystickSnapshot sticks;
+    DS_GetJoystickSnapshot (&sticks);
+
+    /* Encode the axes of all joysticks */
+    uint8_t axes [DS_MAX_JOYSTICKS][DS_MAX_JOYSTICK_AXES];
+    DS_FloatsToBytes (sticks.axes [0], axes [0], max_joysticks * DS_MAX_JOYSTICK_AXES, 1);
 
     /* Add data for every joystick */
     for (i = 0; i < max_joysticks; ++i) {
         /* Add axis data */
-        for (j = 0; j < max_axes; ++j)
-            DS_StrAppend (&buf, DS_FloatToByte (DS_GetJoystickAxis (i, j), 1));
+        DS_BufferAppendBytes (buffer, axes [i], max_axes);
 
-        /* Generate button data */
-        uint16_t button_flags = 0;
-        for (j = 0; j < max_buttons; ++j)
-            button_flags += (uint16_t) DS_GetJoystickButton (i, j) ? j * j : 0;
+        /* Get the states of the first buttons */
+        uint16_t button_flags = (uint16_t) (sticks.buttons [i] & ((1 << max_buttons) - 1));
 
         /* Add button data */
-        DS_StrAppend (&buf, (button_flags & 0xff00) >> 8);
-        DS_StrAppend (&buf, (button_flags & 0xff));
+        DS_BufferAppend (buffer, (button_flags & 0xff00) >> 8);
+        DS_BufferAppend (buffer, (button_flags & 0xff));
     }
-
-    return buf;
 }
 
 /**
@@ -261,21 +262,23 @@ static DS_String robot_address (void)
 /**
  * Generates an empty (ignored) FMS packet.
  */
-static DS_String create_fms_packet (void)
+static int build_fms_packet (DS_Buffer* buffer)
 {
-    return  DS_StrNewLen (0);
+    (void) buffer;
+    return 1;
 }
 
 /**
  * Generates an empty (ignored) radio packet.
  */
-static DS_String create_radio_packet (void)
+static int build_radio_packet (DS_Buffer* buffer)
 {
-    return  DS_StrNewLen (0);
+    (void) buffer;
+    return 1;
 }
 
 /**
- * Generates a DS-to-robot packet. The packet is 1024 bytes long and contains
+ * Writes a DS-to-robot packet. The packet is 1024 bytes long and contains
  * the following data:
  *     - The packet index / ID
  *     - The team number
@@ -286,56 +289,85 @@ static DS_String create_radio_packet (void)
  *     - The version of the FRC Driver Station
  *     - The CRC32 checksum of the packet
  */
-static DS_String create_robot_packet (void)
+static int build_robot_packet (DS_Buffer* buffer)
 {
-    /* Create initial packet */
-    DS_String data = DS_StrNewLen (8);
-
     /* Add packet index */
-    DS_StrSetChar (&data, 0, (sent_robot_packets & 0xff00) >> 8);
-    DS_StrSetChar (&data, 1, (sent_robot_packets & 0xff));
+    DS_BufferAppend (buffer, (sent_robot_packets & 0xff00) >> 8);
+    DS_BufferAppend (buffer, (sent_robot_packets & 0xff));
 
     /* Add control code and digital inputs */
-    DS_StrSetChar (&data, 2, get_control_code());
-    DS_StrSetChar (&data, 3,  get_digital_inputs());
+    DS_BufferAppend (buffer, get_control_code());
+    DS_BufferAppend (buffer, get_digital_inputs());
 
     /* Add team number */
-    DS_StrSetChar (&data, 4, (CFG_GetTeamNumber() & 0xff00) >> 8);
-    DS_StrSetChar (&data, 5, (CFG_GetTeamNumber() & 0xff));
+    DS_BufferAppend (buffer, (CFG_GetTeamNumber() & 0xff00) >> 8);
+    DS_BufferAppend (buffer, (CFG_GetTeamNumber() & 0xff));
 
     /* Add alliance and position */
-    DS_StrSetChar (&data, 6, get_alliance_code());
-    DS_StrSetChar (&data, 7, get_position_code());
+    DS_BufferAppend (buffer, get_alliance_code());
+    DS_BufferAppend (buffer, get_position_code());
 
     /* Add joystick data */
-    DS_String jsData = get_joystick_data();
-    DS_StrJoin (&data, &jsData);
+    add_joystick_data (buffer);
 
     /* Now resize the datagram to 1024 bytes */
-    DS_StrResize (&data, 1024);
+    DS_BufferResize (buffer, 1024);
 
     /* Add FRC Driver Station version (same as FRC DS 17.01) */
-    DS_StrSetChar (&data, 72, (uint8_t) 0x31);
-    DS_StrSetChar (&data, 73, (uint8_t) 0x34);
-    DS_StrSetChar (&data, 74, (uint8_t) 0x30);
-    DS_StrSetChar (&data, 75, (uint8_t) 0x32);
-    DS_StrSetChar (&data, 76, (uint8_t) 0x31);
-    DS_StrSetChar (&data, 77, (uint8_t) 0x37);
-    DS_StrSetChar (&data, 78, (uint8_t) 0x30);
-    DS_StrSetChar (&data, 79, (uint8_t) 0x30);
+    DS_BufferSetByte (buffer, 72, (uint8_t) 0x31);
+    DS_BufferSetByte (buffer, 73, (uint8_t) 0x34);
+    DS_BufferSetByte (buffer, 74, (uint8_t) 0x30);
+    DS_BufferSetByte (buffer, 75, (uint8_t) 0x32);
+    DS_BufferSetByte (buffer, 76, (uint8_t) 0x31);
+    DS_BufferSetByte (buffer, 77, (uint8_t) 0x37);
+    DS_BufferSetByte (buffer, 78, (uint8_t) 0x30);
+    DS_BufferSetByte (buffer, 79, (uint8_t) 0x30);
+
+    /* Packet does not fit in the buffer */
+    if (buffer->overflow)
+        return 0;
 
     /* Add CRC32 checksum */
-    uint32_t checksum = DS_CRC32 (data.buf, DS_StrLen (&data));
-    DS_StrSetChar (&data, 1020, (checksum & 0xff000000) >> 24);
-    DS_StrSetChar (&data, 1021, (checksum & 0xff0000) >> 16);
-    DS_StrSetChar (&data, 1022, (checksum & 0xff00) >> 8);
-    DS_StrSetChar (&data, 1023, (checksum & 0xff));
+    uint32_t checksum = DS_CRC32 (buffer->data, buffer->len);
+    DS_BufferSetByte (buffer, 1020, (checksum & 0xff000000) >> 24);
+    DS_BufferSetByte (buffer, 1021, (checksum & 0xff0000) >> 16);
+    DS_BufferSetByte (buffer, 1022, (checksum & 0xff00) >> 8);
+    DS_BufferSetByte (buffer, 1023, (checksum & 0xff));
 
     /* Increase sent robot packets */
     ++sent_robot_packets;
 
-    /* Return address of data */
-    return data;
+    return 1;
+}
+
+/**
+ * Generates an empty (ignored) FMS packet string.
+ */
+static DS_String create_fms_packet (void)
+{
+    return  DS_StrNewLen (0);
+}
+
+/**
+ * Generates an empty (ignored) radio packet string.
+ */
+static DS_String create_radio_packet (void)
+{
+    return  DS_StrNewLen (0);
+}
+
+/**
+ * Generates a new robot packet string (see \c build_robot_packet())
+ */
+static DS_String create_robot_packet (void)
+{
+    DS_Buffer buffer;
+    uint8_t data [DS_SOCKET_BUFFER_SIZE];
+
+    DS_BufferInit (&buffer, data, sizeof (data));
+    build_robot_packet (&buffer);
+
+    return DS_BufferToString (&buffer);
 }
 
 /**
@@ -476,17 +508,28 @@ DS_Protocol DS_GetProtocolFRC_2014 (void)
     protocol.fms_address = &fms_address;
     protocol.radio_address = &radio_address;
     protocol.robot_address = &robot_address;
+    protocol.robot_candidates = NULL;
 
     /* Set packet generator functions */
     protocol.create_fms_packet = &create_fms_packet;
     protocol.create_radio_packet = &create_radio_packet;
     protocol.create_robot_packet = &create_robot_packet;
 
+    /* Set zero-allocation packet generator functions */
+    protocol.build_fms_packet = &build_fms_packet;
+    protocol.build_radio_packet = &build_radio_packet;
+    protocol.build_robot_packet = &build_robot_packet;
+
     /* Set packet interpretation functions */
     protocol.read_fms_packet = &read_fms_packet;
     protocol.read_radio_packet = &read_radio_packet;
     protocol.read_robot_packet = &read_robot_packet;
 
+    /* The replies of the cRIO are not numbered */
+    protocol.fms_sequence = NULL;
+    protocol.radio_sequence = NULL;
+    protocol.robot_sequence = NULL;
+
     /* Set reset functions */
     protocol.reset_fms = &reset_fms;
     protocol.reset_radio = &reset_radio;
@@ -22,6 +22,7 @@
  */
 
 #include "DS_Utils.h"
+#include "DS_Atomic.h"
 #include "DS_Config.h"
 #include "DS_Protocol.h"
 #include "DS_Joysticks.h"
@@ -83,6 +84,27 @@ static unsigned int sent_robot_packets = 0;
 static int reboot = 0;
 static int restart_code = 0;
 
+/*
+ * Contents of the robot packet after the general header
+ */
+#define BODY_NONE      0
+#define BODY_TIMEZONE  1
+#define BODY_JOYSTICKS 2
+
+/*
+ * The robot packet template holds the last generated robot packet, only the
+ * fields whose source values changed are re-generated for the next packet
+ */
+#define HEADER_SIZE 6
+#define CACHED_JOYSTICKS 32
+static DS_Buffer robot_template;
+static int template_body = BODY_NONE;
+static long template_dirty = CFG_DIRTY_ALL;
+static long template_reset = 1;
+static int template_joysticks = 0;
+static size_t joystick_offsets [CACHED_JOYSTICKS + 1];
+static uint8_t template_data [DS_SOCKET_BUFFER_SIZE];
+
 /**
  * Obtains the voltage float from the given \a upper and \a lower bytes
  */
@@ -257,27 +279,26 @@ static uint8_t get_station_code (void)
  * joystick data (which is sent to the robot) and to resize the client->robot
  * datagram automatically.
  */
-static uint8_t get_joystick_size (const int joystick)
+static uint8_t get_joystick_size (const DS_JoystickSnapshot* sticks,
+                                  const int joystick)
 {
     int header_size = 2;
     int button_data = 3;
-    int axis_data = DS_GetJoystickNumAxes (joystick) + 1;
-    int hat_data = (DS_GetJoystickNumHats (joystick) * 2) + 1;
+    int axis_data = sticks->num_axes [joystick] + 1;
+    int hat_data = (sticks->num_hats [joystick] * 2) + 1;
 
     return header_size + button_data + axis_data + hat_data;
 }
 
 /**
- * Returns information regarding the current date and time and the timezone
- * of the client computer.
+ * Writes information regarding the current date and time and the timezone
+ * of the client computer into the given \a buffer.
  *
  * The robot may ask for this information in some cases (e.g. when initializing
  * the robot code).
  */
-static DS_String get_timezone_data (void)
+static void add_timezone_data (DS_Buffer* buffer)
 {
-    DS_String data = DS_StrNewLen (14);
-
     /* Get current time */
     time_t rt = 0;
     uint32_t ms = 0;
@@ -312,72 +333,189 @@ static DS_String get_timezone_data (void)
 #endif
 
     /* Encode date/time in datagram */
-    DS_StrSetChar (&data, 0,  (uint8_t) 0x0b);
-    DS_StrSetChar (&data, 1,  (uint8_t) cTagDate);
-    DS_StrSetChar (&data, 2,  (uint8_t) (ms >> 24));
-    DS_StrSetChar (&data, 3,  (uint8_t) (ms >> 16));
-    DS_StrSetChar (&data, 4,  (uint8_t) (ms >> 8));
-    DS_StrSetChar (&data, 5,  (uint8_t) (ms));
-    DS_StrSetChar (&data, 6,  (uint8_t) timeinfo.tm_sec);
-    DS_StrSetChar (&data, 7,  (uint8_t) timeinfo.tm_min);
-    DS_StrSetChar (&data, 8,  (uint8_t) timeinfo.tm_hour);
-    DS_StrSetChar (&data, 9,  (uint8_t) timeinfo.tm_yday);
-    DS_StrSetChar (&data, 10, (uint8_t) timeinfo.tm_mon);
-    DS_StrSetChar (&data, 11, (uint8_t) timeinfo.tm_year);
+    DS_BufferAppend (buffer, (uint8_t) 0x0b);
+    DS_BufferAppend (buffer, (uint8_t) cTagDate);
+    DS_BufferAppend (buffer, (uint8_t) (ms >> 24));
+    DS_BufferAppend (buffer, (uint8_t) (ms >> 16));
+    DS_BufferAppend (buffer, (uint8_t) (ms >> 8));
+    DS_BufferAppend (buffer, (uint8_t) (ms));
+    DS_BufferAppend (buffer, (uint8_t) timeinfo.tm_sec);
+    DS_BufferAppend (buffer, (uint8_t) timeinfo.tm_min);
+    DS_BufferAppend (buffer, (uint8_t) timeinfo.tm_hour);
+    DS_BufferAppend (buffer, (uint8_t) timeinfo.tm_yday);
+    DS_BufferAppend (buffer, (uint8_t) timeinfo.tm_mon);
+    DS_BufferAppend (buffer, (uint8_t) timeinfo.tm_year);
 
     /* Add timezone length and tag */
-    DS_StrSetChar (&data, 12, DS_StrLen (&tz));
-    DS_StrSetChar (&data, 13, cTagTimezone);
+    DS_BufferAppend (buffer, DS_StrLen (&tz));
+    DS_BufferAppend (buffer, cTagTimezone);
 
     /* Add timezone string */
-    DS_StrJoin (&data, &tz);
+    DS_BufferAppendBytes (buffer, tz.buf, tz.len);
+    DS_StrRmBuf (&tz);
+}
+
+/**
+ * Writes the joystick information structure of the given \a joystick into
+ * the given \a buffer, \a axes contains the encoded axis values of the
+ * joystick
+ */
+static void add_joystick (DS_Buffer* buffer, const DS_JoystickSnapshot* sticks,
+                          const uint8_t* axes, const int joystick)
+{
+    int j = 0;
 
-    /* Return the obtained data */
-    return data;
+    /* Add joystick header */
+    DS_BufferAppend (buffer, get_joystick_size (sticks, joystick));
+    DS_BufferAppend (buffer, cTagJoystick);
+
+    /* Add axis data */
+    DS_BufferAppend (buffer, sticks->num_axes [joystick]);
+    DS_BufferAppendBytes (buffer, axes, sticks->num_axes [joystick]);
+
+    /* Only the first 16 buttons are sent */
+    uint16_t button_flags = (uint16_t) sticks->buttons [joystick];
+
+    /* Add button data */
+    DS_BufferAppend (buffer, sticks->num_buttons [joystick]);
+    DS_BufferAppend (buffer, (uint8_t) (button_flags >> 8));
+    DS_BufferAppend (buffer, (uint8_t) (button_flags));
+
+    /* Add hat data */
+    DS_BufferAppend (buffer, sticks->num_hats [joystick]);
+    for (j = 0; j < sticks->num_hats [joystick]; ++j) {
+        DS_BufferAppend (buffer, (uint8_t) (sticks->hats [joystick][j] >> 8));
+        DS_BufferAppend (buffer, (uint8_t) (sticks->hats [joystick][j]));
+    }
 }
 
 /**
- * Constructs a joystick information structure for every attached joystick.
- * Unlike the 2014 protocol, the 2015 protocol only generates joystick data
- * for the attached joysticks.
+ * Updates the joystick data of the robot packet template. Unlike the 2014
+ * protocol, the 2015 protocol only generates joystick data for the attached
+ * joysticks.
+ *
+ * The joysticks marked in \a changes are re-generated in-place, the rest of
+ * the joysticks keep their previous data. If a joystick changed its size
+ * (or the joystick count changed), the data of every joystick after it is
+ * re-generated.
  */
-static DS_String get_joystick_data (void)
+static void update_joystick_data (const unsigned long changes)
 {
-    /* Initialize the variables */
     int i = 0;
-    int j = 0;
-    DS_String data = DS_StrNewLen (0);
-
-    /* Generate data for each joystick */
-    for (i = 0; i < DS_GetJoystickCount(); ++i) {
-        DS_StrAppend (&data, get_joystick_size (i));
-        DS_StrAppend (&data, cTagJoystick);
-
-        /* Add axis data */
-        DS_StrAppend (&data, DS_GetJoystickNumAxes (i));
-        for (j = 0; j < DS_GetJoystickNumAxes (i); ++j)
-            DS_StrAppend (&data, DS_FloatToByte (DS_GetJoystickAxis (i, j), 1));
-
-        /* Generate button data */
-        uint16_t button_flags = 0;
-        for (j = 0; j < DS_GetJoystickNumButtons (i); ++j)
-            button_flags += DS_GetJoystickButton (i, j) ? (int) pow (2, j) : 0;
-
-        /* Add button data */
-        DS_StrAppend (&data, DS_GetJoystickNumButtons (i));
-        DS_StrAppend (&data, (uint8_t) (button_flags >> 8));
-        DS_StrAppend (&data, (uint8_t) (button_flags));
-
-        /* Add hat data */
-        DS_StrAppend (&data, DS_GetJoystickNumHats (i));
-        for (j = 0; j < DS_GetJoystickNumHats (i); ++j) {
-            DS_StrAppend (&data, (uint8_t) (DS_GetJoystickHat (i, j) >> 8));
-            DS_StrAppend (&data, (uint8_t) (DS_GetJoystickHat (i, j)));
+    int count = DS_GetJoystickCount();
+    int first = DS_Min (count, template_joysticks);
+    first = DS_Min (first, CACHED_JOYSTICKS);
+
+    /* Nothing changed */
+    if (!changes && count == template_joysticks && count <= CACHED_JOYSTICKS)
+        return;
+
+    /* Get the joystick values */
+    DS_JoystickSnapshot sticks;
+    DS_GetJoystickSnapshot (&sticks);
+    count = sticks.count;
+    first = DS_Min (first, count);
+
+    /* Encode the axes of all joysticks */
+    uint8_t axes [DS_MAX_JOYSTICKS][DS_MAX_JOYSTICK_AXES];
+    DS_FloatsToBytes (sticks.axes [0], axes [0], count * DS_MAX_JOYSTICK_AXES, 1);
+
+    /* Patch the joysticks that changed, but kept their size */
+    for (i = 0; i < first; ++i) {
+        if (DS_JOYSTICK_DIRTY (changes, i)) {
+            size_t size = joystick_offsets [i + 1] - joystick_offsets [i];
+
+            /* Joystick layout changed, re-generate the rest of the packet */
+            if (size != get_joystick_size (&sticks, i)) {
+                first = i;
+                break;
+            }
+
+            /* Overwrite the joystick data */
+            DS_Buffer stick;
+            DS_BufferInit (&stick, robot_template.data + joystick_offsets [i], size);
+            add_joystick (&stick, &sticks, axes [i], i);
         }
     }
 
-    /* Return obtained data */
-    return data;
+    /* Re-generate the joysticks after the first joystick that moved */
+    DS_BufferResize (&robot_template, joystick_offsets [first]);
+    for (i = first; i < count; ++i) {
+        add_joystick (&robot_template, &sticks, axes [i], i);
+
+        if (i < CACHED_JOYSTICKS)
+            joystick_offsets [i + 1] = robot_template.len;
+    }
+
+    template_joysticks = count;
+}
+
+/**
+ * Discards the robot packet template, the next robot packet will be
+ * generated from scratch
+ */
+static void reset_template (void)
+{
+    DS_BufferInit (&robot_template, template_data, sizeof (template_data));
+    DS_BufferResize (&robot_template, HEADER_SIZE);
+    DS_BufferSetByte (&robot_template, 2, cTagGeneral);
+
+    template_body = BODY_NONE;
+    template_joysticks = 0;
+    DS_AtomicStore (&template_dirty, CFG_DIRTY_ALL);
+    joystick_offsets [0] = HEADER_SIZE;
+}
+
+/**
+ * Re-generates the fields of the robot packet template whose source values
+ * changed since the last robot packet was generated
+ */
+static void update_template (void)
+{
+    /* Get the fields that changed */
+    unsigned long changes = DS_TakeJoystickDirtyFlags();
+    int flags = CFG_TakeDirtyFlags() | (int) DS_AtomicExchange (&template_dirty, 0);
+
+    /* Get the data that follows the general header */
+    int body = BODY_NONE;
+    if (send_time_data)
+        body = BODY_TIMEZONE;
+    else if (sent_robot_packets > 5)
+        body = BODY_JOYSTICKS;
+
+    /* Update control code, request flags and team station */
+    if (flags & CFG_DIRTY_CONTROL)
+        DS_BufferSetByte (&robot_template, 3, get_control_code());
+    if (flags & (CFG_DIRTY_CONTROL | CFG_DIRTY_REQUEST))
+        DS_BufferSetByte (&robot_template, 4, get_request_code());
+    if (flags & CFG_DIRTY_STATION)
+        DS_BufferSetByte (&robot_template, 5, get_station_code());
+
+    /* Packet body changed, discard the old body */
+    if (body != template_body) {
+        template_joysticks = 0;
+        DS_BufferResize (&robot_template, HEADER_SIZE);
+    }
+
+    /* Joystick values are neutral while the robot is disabled */
+    if (flags & CFG_DIRTY_CONTROL)
+        changes = ~0UL;
+
+    /* Add timezone data (it changes with every packet) */
+    if (body == BODY_TIMEZONE) {
+        DS_BufferResize (&robot_template, HEADER_SIZE);
+        add_timezone_data (&robot_template);
+    }
+
+    /* Add joystick data */
+    else if (body == BODY_JOYSTICKS)
+        update_joystick_data (changes);
+
+    /* Only send the general header */
+    else
+        DS_BufferResize (&robot_template, HEADER_SIZE);
+
+    template_body = body;
 }
 
 /**
@@ -467,7 +605,23 @@ static DS_String robot_address (void)
 }
 
 /**
- * Generates a packet that the DS will send to the FMS, it contains:
+ * The roboRIO can also be reached at its static IP (10.te.am.2) and, when
+ * it is connected through USB, at 172.22.11.2
+ */
+static int robot_candidates (DS_String* addresses, const int max)
+{
+    int count = 0;
+
+    if (count < max)
+        addresses [count++] = DS_GetStaticIP (10, CFG_GetTeamNumber(), 2);
+    if (count < max)
+        addresses [count++] = DS_StrNew ("172.22.11.2");
+
+    return count;
+}
+
+/**
+ * Writes a packet that the DS will send to the FMS, it contains:
  *    - The FMS packet index
  *    - The robot voltage
  *    - Robot control code
@@ -475,36 +629,33 @@ static DS_String robot_address (void)
  *    - Radio and robot ping flags
  *    - The team number
  */
-static DS_String create_fms_packet (void)
+static int build_fms_packet (DS_Buffer* buffer)
 {
-    /* Create an 8-byte long packet */
-    DS_String data = DS_StrNewLen (8);
-
     /* Get voltage bytes */
     uint8_t integer = 0;
     uint8_t decimal = 0;
     encode_voltage (CFG_GetRobotVoltage(), &integer, &decimal);
 
     /* Add FMS packet count */
-    DS_StrSetChar (&data, 0, (sent_fms_packets >> 8));
-    DS_StrSetChar (&data, 1, (sent_fms_packets));
+    DS_BufferAppend (buffer, (sent_fms_packets >> 8));
+    DS_BufferAppend (buffer, (sent_fms_packets));
 
     /* Add DS version and FMS control code */
-    DS_StrSetChar (&data, 2, cFMS_DS_Version);
-    DS_StrSetChar (&data, 3, fms_control_code());
+    DS_BufferAppend (buffer, cFMS_DS_Version);
+    DS_BufferAppend (buffer, fms_control_code());
 
     /* Add team number */
-    DS_StrSetChar (&data, 4, (CFG_GetTeamNumber() >> 8));
-    DS_StrSetChar (&data, 5, (CFG_GetTeamNumber()));
+    DS_BufferAppend (buffer, (CFG_GetTeamNumber() >> 8));
+    DS_BufferAppend (buffer, (CFG_GetTeamNumber()));
 
     /* Add robot voltage */
-    DS_StrSetChar (&data, 6, integer);
-    DS_StrSetChar (&data, 7, decimal);
+    DS_BufferAppend (buffer, integer);
+    DS_BufferAppend (buffer, decimal);
 
     /* Increase FMS packet counter */
     ++sent_fms_packets;
 
-    return data;
+    return !buffer->overflow;
 }
 
 /**
@@ -512,13 +663,14 @@ static DS_String create_fms_packet (void)
  * to the DS Radio / Bridge. For that reason, the 2015 communication protocol
  * generates empty radio packets.
  */
-static DS_String create_radio_packet (void)
+static int build_radio_packet (DS_Buffer* buffer)
 {
-    return  DS_StrNewLen (0);
+    (void) buffer;
+    return 1;
 }
 
 /**
- * Generates a packet that the DS will send to the robot, it contains the
+ * Writes a packet that the DS will send to the robot, it contains the
  * following information:
  *    - Packet index / ID
  *    - Control code (control modes, e-stop state, etc)
@@ -527,38 +679,67 @@ static DS_String create_radio_packet (void)
  *    - Date and time data (if robot requests it)
  *    - Joystick information (if the robot does not want date/time)
  */
-static DS_String create_robot_packet (void)
+static int build_robot_packet (DS_Buffer* buffer)
 {
-    DS_String data = DS_StrNewLen (6);
+    /* Protocol was (re)loaded, generate the packet from scratch */
+    if (DS_AtomicExchange (&template_reset, 0))
+        reset_template();
 
-    /* Add packet index */
-    DS_StrSetChar (&data, 0, (sent_robot_packets >> 8));
-    DS_StrSetChar (&data, 1, (sent_robot_packets));
+    /* Re-generate the fields that changed */
+    update_template();
 
-    /* Add packet header */
-    DS_StrSetChar (&data, 2, cTagGeneral);
-
-    /* Add control code, request flags and team station */
-    DS_StrSetChar (&data, 3, get_control_code());
-    DS_StrSetChar (&data, 4, get_request_code());
-    DS_StrSetChar (&data, 5, get_station_code());
+    /* Add packet index */
+    DS_BufferSetByte (&robot_template, 0, (sent_robot_packets >> 8));
+    DS_BufferSetByte (&robot_template, 1, (sent_robot_packets));
 
-    /* Add timezone data (if robot wants it) */
-    if (send_time_data) {
-        DS_String tz = get_timezone_data();
-        DS_StrJoin (&data, &tz);
-    }
+    /* Copy the packet */
+    int ok = !robot_template.overflow;
+    DS_BufferAppendBytes (buffer, robot_template.data, robot_template.len);
 
-    /* Add joystick data */
-    else if (sent_robot_packets > 5) {
-        DS_String js = get_joystick_data();
-        DS_StrJoin (&data, &js);
-    }
+    /* Template is incomplete, generate the next packet from scratch */
+    if (!ok)
+        reset_template();
 
     /* Increase robot packet counter */
     ++sent_robot_packets;
 
-    return data;
+    return ok && !buffer->overflow;
+}
+
+/**
+ * Generates a new FMS packet string (see \c build_fms_packet())
+ */
+static DS_String create_fms_packet (void)
+{
+    DS_Buffer buffer;
+    uint8_t data [DS_SOCKET_BUFFER_SIZE];
+
+    DS_BufferInit (&buffer, data, sizeof (data));
+    build_fms_packet (&buffer);
+
+    return DS_BufferToString (&buffer);
+}
+
+/**
+ * Generates a new (empty) radio packet string
+ */
+static DS_String create_radio_packet (void)
+{
+    return  DS_StrNewLen (0);
+}
+
+/**
+ * Generates a new robot packet string (see \c build_robot_packet())
+ */
+static DS_String create_robot_packet (void)
+{
+    DS_Buffer buffer;
+    uint8_t data [DS_SOCKET_BUFFER_SIZE];
+
+    DS_BufferInit (&buffer, data, sizeof (data));
+    build_robot_packet (&buffer);
+
+    return DS_BufferToString (&buffer);
 }
 
 /**
@@ -658,6 +839,32 @@ static int read_robot_packet (const DS_String* data)
     return 1;
 }
 
+/**
+ * Returns the sequence number of the given FMS packet. The FMS numbers its
+ * packets independently from the DS, so sent packets are not tracked.
+ */
+static int fms_sequence (const uint8_t* data, const size_t len, const int sent)
+{
+    if (sent || len < 2)
+        return -1;
+
+    return (data [0] << 8) | data [1];
+}
+
+/**
+ * Returns the sequence number of the given robot packet, the robot replies
+ * with the sequence number of the last packet that it received from us.
+ */
+static int robot_sequence (const uint8_t* data, const size_t len, const int sent)
+{
+    (void) sent;
+
+    if (len < 2)
+        return -1;
+
+    return (data [0] << 8) | data [1];
+}
+
 /**
  * Called when the FMS watchdog expires, does nothing...
  */
@@ -682,6 +889,7 @@ static void reset_robot (void)
     reboot = 0;
     restart_code = 0;
     send_time_data = 0;
+    DS_AtomicOr (&template_dirty, CFG_DIRTY_REQUEST);
 }
 
 /**
@@ -690,6 +898,7 @@ static void reset_robot (void)
 static void reboot_robot (void)
 {
     reboot = 1;
+    DS_AtomicOr (&template_dirty, CFG_DIRTY_REQUEST);
 }
 
 /**
@@ -699,6 +908,7 @@ static void reboot_robot (void)
 static void restart_robot_code (void)
 {
     restart_code = 1;
+    DS_AtomicOr (&template_dirty, CFG_DIRTY_REQUEST);
 }
 
 /**
@@ -712,21 +922,35 @@ DS_Protocol DS_GetProtocolFRC_2015 (void)
     /* Set protocol name */
     protocol.name = DS_StrNew ("FRC 2015");
 
+    /* Generate the first robot packet from scratch (in the event thread) */
+    DS_AtomicStore (&template_reset, 1);
+
     /* Set address functions */
     protocol.fms_address = &fms_address;
     protocol.radio_address = &radio_address;
     protocol.robot_address = &robot_address;
+    protocol.robot_candidates = &robot_candidates;
 
     /* Set packet generator functions */
     protocol.create_fms_packet = &create_fms_packet;
     protocol.create_radio_packet = &create_radio_packet;
     protocol.create_robot_packet = &create_robot_packet;
 
+    /* Set zero-allocation packet generator functions */
+    protocol.build_fms_packet = &build_fms_packet;
+    protocol.build_radio_packet = &build_radio_packet;
+    protocol.build_robot_packet = &build_robot_packet;
+
     /* Set packet interpretation functions */
     protocol.read_fms_packet = &read_fms_packet;
     protocol.read_radio_packet = &read_radio_packet;
     protocol.read_robot_packet = &read_robot_packet;
 
+    /* Set sequence number functions */
+    protocol.fms_sequence = &fms_sequence;
+    protocol.radio_sequence = NULL;
+    protocol.robot_sequence = &robot_sequence;
+
     /* Set reset functions */
     protocol.reset_fms = &reset_fms;
     protocol.reset_radio = &reset_radio;
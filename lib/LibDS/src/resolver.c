@@ -0,0 +1,408 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "DS_Timer.h"
+#include "DS_Utils.h"
+#include "DS_Resolver.h"
+
+#include <socky.h>
+#include <assert.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * Resolver settings
+ */
+#define HOST_SIZE     512      /* Max. length of a host name */
+#define SERVICE_SIZE  12       /* Max. length of a service/port string */
+#define THREAD_COUNT  3        /* Number of lookups that can run in parallel */
+#define QUEUE_SIZE    32       /* Max. number of pending lookups */
+#define CACHE_SIZE    16       /* Number of cached addresses */
+#define POSITIVE_TTL  30000000 /* Time to keep a resolved address (usecs) */
+#define NEGATIVE_TTL  1000000  /* Time to remember a failed lookup (usecs) */
+
+/**
+ * Holds a lookup that is waiting for a worker thread
+ */
+typedef struct {
+    char host [HOST_SIZE];
+    char service [SERVICE_SIZE];
+    DS_ResolverCallback callback;
+    void* data;
+    int generation;
+    int index;
+} Request;
+
+/**
+ * Holds the result of a previous lookup
+ */
+typedef struct {
+    char host [HOST_SIZE];
+    char service [SERVICE_SIZE];
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint64_t expires;
+} CacheEntry;
+
+/*
+ * Request queue, cache and the lookups that each worker is running,
+ * protected by the resolver mutex
+ */
+static int running = 0;
+static int queue_head = 0;
+static int queue_count = 0;
+static Request queue [QUEUE_SIZE];
+static CacheEntry cache [CACHE_SIZE];
+static Request active [THREAD_COUNT];
+static pthread_t threads [THREAD_COUNT];
+static pthread_cond_t resolver_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t resolver_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Returns the cache entry that matches the given \a host and \a service,
+ * this function must be called with the resolver mutex locked
+ */
+static CacheEntry* find_entry (const char* host, const char* service)
+{
+    int i;
+    for (i = 0; i < CACHE_SIZE; ++i) {
+        if (cache [i].expires > 0 &&
+                strcmp (cache [i].host, host) == 0 &&
+                strcmp (cache [i].service, service) == 0)
+            return &cache [i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Saves the result of a lookup, replacing the entry that expires first.
+ * This function must be called with the resolver mutex locked
+ */
+static void save_entry (const Request* request,
+                        const struct sockaddr_storage* addr,
+                        const socklen_t addr_len)
+{
+    int i;
+    CacheEntry* entry = find_entry (request->host, request->service);
+
+    /* Replace the oldest entry */
+    if (!entry) {
+        entry = &cache [0];
+        for (i = 1; i < CACHE_SIZE; ++i) {
+            if (cache [i].expires < entry->expires)
+                entry = &cache [i];
+        }
+    }
+
+    /* Save the result */
+    memset (entry, 0, sizeof (CacheEntry));
+    memcpy (entry->host, request->host, sizeof (entry->host));
+    memcpy (entry->service, request->service, sizeof (entry->service));
+    entry->addr_len = addr_len;
+    if (addr_len > 0)
+        memcpy (&entry->addr, addr, sizeof (entry->addr));
+
+    /* Failed lookups are retried sooner */
+    entry->expires = DS_GetTimestamp() + (addr_len > 0 ? POSITIVE_TTL : NEGATIVE_TTL);
+}
+
+/**
+ * Returns \c 1 if both requests look up the same host and service
+ */
+static int same_lookup (const Request* a, const Request* b)
+{
+    return strcmp (a->host, b->host) == 0 && strcmp (a->service, b->service) == 0;
+}
+
+/**
+ * Returns the position (in the queue) of the oldest request that is not
+ * being resolved by a worker already, or \c -1 if there is none.
+ * This function must be called with the resolver mutex locked
+ */
+static int next_request (void)
+{
+    int i;
+    int j;
+    for (i = 0; i < queue_count; ++i) {
+        const Request* request = &queue [(queue_head + i) % QUEUE_SIZE];
+
+        for (j = 0; j < THREAD_COUNT; ++j) {
+            if (same_lookup (&active [j], request))
+                break;
+        }
+
+        if (j == THREAD_COUNT)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Removes the request at the given \a position of the queue and returns it.
+ * This function must be called with the resolver mutex locked
+ */
+static Request take_request (const int position)
+{
+    int i;
+    Request request = queue [(queue_head + position) % QUEUE_SIZE];
+
+    /* Move the newer requests one slot back */
+    for (i = position; i < queue_count - 1; ++i)
+        queue [(queue_head + i) % QUEUE_SIZE] = queue [(queue_head + i + 1) % QUEUE_SIZE];
+
+    queue_count -= 1;
+    return request;
+}
+
+/**
+ * Waits for lookup requests and resolves them, several workers run at the
+ * same time so that a slow lookup (e.g. an mDNS name that does not exist)
+ * does not delay the rest of the lookups.
+ *
+ * A host is only resolved by one worker at a time, requests for a host that
+ * is being resolved wait in the queue and get the result of that lookup.
+ */
+static void* run_worker (void* data)
+{
+    int i;
+    int waiting;
+    int position;
+    Request waiters [QUEUE_SIZE];
+    Request* lookup = (Request*) data;
+
+    while (1) {
+        /* Wait for a request that is not being resolved */
+        pthread_mutex_lock (&resolver_mutex);
+        while (running && (position = next_request()) < 0)
+            pthread_cond_wait (&resolver_cond, &resolver_mutex);
+
+        /* Resolver is closing */
+        if (!running) {
+            pthread_mutex_unlock (&resolver_mutex);
+            break;
+        }
+
+        /* Take the request */
+        Request request = take_request (position);
+        *lookup = request;
+        pthread_mutex_unlock (&resolver_mutex);
+
+        /* Resolve the address */
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof (addr);
+        if (resolve_address (request.host, request.service,
+                             SOCKY_UDP, SOCKY_IPv4, &addr, &addr_len) != 0)
+            addr_len = 0;
+
+        /* Save the result and take the requests that waited for it */
+        waiting = 0;
+        pthread_mutex_lock (&resolver_mutex);
+        save_entry (&request, &addr, addr_len);
+        memset (lookup, 0, sizeof (Request));
+        for (i = 0; i < queue_count;) {
+            if (same_lookup (&queue [(queue_head + i) % QUEUE_SIZE], &request))
+                waiters [waiting++] = take_request (i);
+            else
+                ++i;
+        }
+        pthread_mutex_unlock (&resolver_mutex);
+
+        /* Report the result */
+        request.callback (request.data, request.generation, request.index,
+                          &addr, (int) addr_len);
+        for (i = 0; i < waiting; ++i)
+            waiters [i].callback (waiters [i].data, waiters [i].generation,
+                                  waiters [i].index, &addr, (int) addr_len);
+    }
+
+    return NULL;
+}
+
+/**
+ * Starts the resolver threads
+ */
+void Resolver_Init (void)
+{
+    int i;
+
+    /* Clear the queue and the cache */
+    pthread_mutex_lock (&resolver_mutex);
+    running = 1;
+    queue_head = 0;
+    queue_count = 0;
+    memset (cache, 0, sizeof (cache));
+    memset (active, 0, sizeof (active));
+    pthread_mutex_unlock (&resolver_mutex);
+
+    /* Start the workers */
+    for (i = 0; i < THREAD_COUNT; ++i) {
+        int error = pthread_create (&threads [i], NULL, &run_worker, &active [i]);
+
+        /* Warn the user when a worker cannot start */
+        if (error) {
+            DS_String caption = DS_StrNew ("LibDS");
+            DS_String message = DS_StrNew ("Cannot start resolver thread!");
+            DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
+            DS_StrRmBuf (&caption);
+            DS_StrRmBuf (&message);
+        }
+
+        /* Quit if the worker cannot start */
+        assert (!error);
+    }
+}
+
+/**
+ * Stops the resolver threads, pending requests are discarded and lookups
+ * that are already running are allowed to finish
+ */
+void Resolver_Close (void)
+{
+    int i;
+
+    /* Tell the workers to stop */
+    pthread_mutex_lock (&resolver_mutex);
+    running = 0;
+    queue_count = 0;
+    pthread_cond_broadcast (&resolver_cond);
+    pthread_mutex_unlock (&resolver_mutex);
+
+    /* Wait for the workers */
+    for (i = 0; i < THREAD_COUNT; ++i)
+        pthread_join (threads [i], NULL);
+}
+
+/**
+ * Removes the cached addresses of the given \a host (for every service), so
+ * that the next lookup of the host queries the name resolver again. This is
+ * used when the host stops answering, the rest of the cache is kept.
+ */
+void DS_ResolverInvalidate (const char* host)
+{
+    int i;
+
+    /* Check arguments */
+    if (!host)
+        return;
+
+    pthread_mutex_lock (&resolver_mutex);
+    for (i = 0; i < CACHE_SIZE; ++i) {
+        if (cache [i].expires > 0 && strcmp (cache [i].host, host) == 0)
+            memset (&cache [i], 0, sizeof (CacheEntry));
+    }
+    pthread_mutex_unlock (&resolver_mutex);
+}
+
+/**
+ * Resolves the given \a host and \a service in a background thread and
+ * reports the result through the given \a callback, together with the
+ * \a data, \a generation and \a index values.
+ *
+ * If the \a host is a numeric address or its address is cached (and has not
+ * expired), the \a callback is called immediately from the calling thread.
+ * If a request for the same \a host and \a data is still waiting in the
+ * queue, it is replaced by the new request.
+ *
+ * \param host the host name or IP address to resolve
+ * \param service the service name or port string
+ * \param callback the function to call with the result
+ * \param data user data passed to the \a callback
+ * \param generation user value passed to the \a callback
+ * \param index user value passed to the \a callback
+ */
+void DS_ResolverLookup (const char* host,
+                        const char* service,
+                        DS_ResolverCallback callback,
+                        void* data,
+                        const int generation,
+                        const int index)
+{
+    /* Check arguments */
+    assert (host);
+    assert (service);
+    assert (callback);
+
+    int i;
+    Request request;
+    memset (&request, 0, sizeof (request));
+    strncpy (request.host, host, sizeof (request.host) - 1);
+    strncpy (request.service, service, sizeof (request.service) - 1);
+    request.callback = callback;
+    request.generation = generation;
+    request.index = index;
+    request.data = data;
+
+    /* Numeric addresses do not need a worker (or the cache) */
+    struct sockaddr_storage numeric;
+    socklen_t numeric_len = sizeof (numeric);
+    if (resolve_numeric_address (request.host, request.service,
+                                 SOCKY_UDP, SOCKY_IPv4,
+                                 &numeric, &numeric_len) == 0) {
+        callback (data, generation, index, &numeric, (int) numeric_len);
+        return;
+    }
+
+    pthread_mutex_lock (&resolver_mutex);
+
+    /* Resolver is not running */
+    if (!running) {
+        pthread_mutex_unlock (&resolver_mutex);
+        callback (data, generation, index, NULL, 0);
+        return;
+    }
+
+    /* Use the cached address */
+    CacheEntry* entry = find_entry (request.host, request.service);
+    if (entry && entry->expires > DS_GetTimestamp()) {
+        struct sockaddr_storage addr = entry->addr;
+        socklen_t addr_len = entry->addr_len;
+        pthread_mutex_unlock (&resolver_mutex);
+
+        callback (data, generation, index, &addr, (int) addr_len);
+        return;
+    }
+
+    /* Replace an older request for the same host */
+    for (i = 0; i < queue_count; ++i) {
+        Request* queued = &queue [(queue_head + i) % QUEUE_SIZE];
+        if (queued->data == data && strcmp (queued->host, request.host) == 0) {
+            *queued = request;
+            pthread_mutex_unlock (&resolver_mutex);
+            return;
+        }
+    }
+
+    /* Queue is full, discard the oldest request */
+    if (queue_count >= QUEUE_SIZE) {
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_count -= 1;
+    }
+
+    /* Queue the request and wake up a worker */
+    queue [(queue_head + queue_count) % QUEUE_SIZE] = request;
+    queue_count += 1;
+    pthread_cond_signal (&resolver_cond);
+    pthread_mutex_unlock (&resolver_mutex);
+}
@@ -21,12 +21,31 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#if defined __linux__
+    #define _GNU_SOURCE
+#endif
+
 #include "DS_Utils.h"
 #include "DS_Socket.h"
+#include "DS_Resolver.h"
 
 #include <socky.h>
 #include <assert.h>
 
+#if defined __linux__
+    #include <errno.h>
+    #include <sys/epoll.h>
+    #define USE_EPOLL 1
+    #define USE_RECVMMSG 1
+    #define USE_SENDMMSG 1
+#elif defined _WIN32
+    #define poll WSAPoll
+#else
+    #include <poll.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+#endif
+
 #define SPRINTF_S snprintf
 #ifdef _WIN32
     #ifndef __MINGW32__
@@ -35,97 +54,686 @@
     #endif
 #endif
 
+/*
+ * Maximum number of sockets that the reactor can watch at the same time
+ */
+#define MAX_SOCKETS 32
+
+/*
+ * Called every time that a socket receives some data, the pointer is only
+ * read and changed with the reactor mutex locked
+ */
+static void (*ready_callback) (void) = NULL;
+
+/*
+ * Reactor state, a single thread waits for data on all open sockets
+ */
+static int reactor_running = 0;
+static int next_generation = 0;
+static int socket_count = 0;
+static int wakeup_sfd = -1;
+static pthread_t reactor_thread;
+static DS_Socket* sockets [MAX_SOCKETS];
+static pthread_mutex_t reactor_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#if defined USE_EPOLL
+static int epoll_fd = -1;
+#endif
+
+/*
+ * Datagrams queued between DS_SocketBatchBegin() and DS_SocketBatchFlush(),
+ * the datagrams of each socket are sent with a single sendmmsg() call
+ */
+#if defined USE_SENDMMSG
+#define MAX_BATCH 16
+
+/*
+ * Holds a queued datagram and the socket that sends it
+ */
+typedef struct {
+    int sfd;                          /* Output socket of the datagram */
+    int size;                         /* Size of the datagram */
+    int packet;                       /* Index of the packet in the batch */
+    int connected;                    /* 1 if the socket is connected */
+    DS_SocketAddress address;         /* Destination (if not connected) */
+    char data [DS_SOCKET_BUFFER_SIZE]; /* Datagram data */
+} BatchDatagram;
+
+/*
+ * Holds a queued packet, a packet may be sent to several candidate
+ * addresses, so it may have more than one datagram
+ */
+typedef struct {
+    int bytes;                        /* Bytes sent, -1 if nothing was sent */
+    void* data;                       /* Argument of the callback */
+    DS_SocketSentCallback callback;   /* Called once the packet is sent */
+} BatchPacket;
+
+static int batch_count = 0;
+static int batch_active = 0;
+static int packet_count = 0;
+static pthread_t batch_thread;
+static BatchDatagram batch [MAX_BATCH];
+static BatchPacket batch_packets [MAX_BATCH];
+#endif
+
 /**
- * Copies the received data from the socket in its data buffer
+ * Receives up to \a max datagrams from the given socket and writes them
+ * directly into the queue of the socket, starting at the \a first slot.
+ *
+ * On Linux, we use \c recvmmsg() to drain several UDP datagrams with a
+ * single system call, on the rest of the platforms (and for TCP sockets)
+ * we read a single datagram per call.
+ *
+ * If \a senders is not \c NULL, the address of the host that sent each
+ * datagram is written to it.
+ *
+ * \returns the number of datagrams received
  */
-static void read_socket (DS_Socket* ptr)
+static int receive_datagrams (DS_Socket* ptr, const int first, const int max,
+                              DS_SocketAddress* senders)
 {
     /* Check arguments */
     assert (ptr);
+    assert (max > 0);
+    assert (first + max <= DS_SOCKET_QUEUE_SIZE);
 
-    /* Initialize temporary buffer */
-    int read = -1;
-    char data [4096] = {0};
-
-    /* Read TCP socket */
-    if (ptr->type == DS_SOCKET_TCP)
-        read = recv (ptr->info.sock_in, data, sizeof (data), 0);
+    DS_Datagram* queue = ptr->info.queue;
 
-    /* Read UDP socket */
+#if defined USE_RECVMMSG
     if (ptr->type == DS_SOCKET_UDP) {
-        read = udp_recvfrom (ptr->info.sock_in, data, sizeof (data),
-                             ptr->address, ptr->info.in_service, 0);
+        struct mmsghdr msgs [DS_SOCKET_QUEUE_SIZE];
+        struct iovec iovecs [DS_SOCKET_QUEUE_SIZE];
+        struct sockaddr_storage names [DS_SOCKET_QUEUE_SIZE];
+        memset (msgs, 0, sizeof (msgs));
+
+        /* Point each message to its queue slot */
+        int i;
+        for (i = 0; i < max; ++i) {
+            iovecs [i].iov_base = queue [first + i].data;
+            iovecs [i].iov_len = sizeof (queue [first + i].data);
+            msgs [i].msg_hdr.msg_iov = &iovecs [i];
+            msgs [i].msg_hdr.msg_iovlen = 1;
+
+            if (senders) {
+                msgs [i].msg_hdr.msg_name = &names [i];
+                msgs [i].msg_hdr.msg_namelen = sizeof (names [i]);
+            }
+        }
+
+        /* Receive the datagrams */
+        int count = recvmmsg (ptr->info.sock_in, msgs, max, MSG_DONTWAIT, NULL);
+        for (i = 0; i < count; ++i) {
+            queue [first + i].size = (int) msgs [i].msg_len;
+
+            if (senders) {
+                senders [i].len = (int) msgs [i].msg_hdr.msg_namelen;
+                memcpy (senders [i].data, &names [i], senders [i].len);
+            }
+        }
+
+        return DS_Max (count, 0);
     }
+#endif
 
-    /* We received some data, copy it to socket's buffer */
-    if (read > 0) {
-        ptr->info.buffer_size = read;
-        memset (ptr->info.buffer, 0, ptr->info.buffer_size);
+    /* Read a single datagram (the socket is non-blocking) */
+    struct sockaddr_storage name;
+    socklen_t name_len = sizeof (name);
+    int bytes = recvfrom (ptr->info.sock_in, queue [first].data,
+                          sizeof (queue [first].data), 0,
+                          (struct sockaddr*) &name, &name_len);
+    if (bytes <= 0)
+        return 0;
 
-        int i;
-        for (i = 0; i < read; ++i)
-            ptr->info.buffer [i] = data [i];
+    /* Save the sender address */
+    if (senders) {
+        senders [0].len = (int) DS_Min (name_len, sizeof (name));
+        memcpy (senders [0].data, &name, senders [0].len);
+    }
+
+    queue [first].size = bytes;
+    return 1;
+}
+
+/**
+ * Reads and discards every datagram waiting in the given socket, this is
+ * used when the queue is full and its oldest datagram is still being read.
+ *
+ * \returns the number of discarded datagrams
+ */
+static int discard_datagrams (DS_Socket* ptr)
+{
+    /* Only the reactor thread uses this buffer */
+    static char discarded [DS_SOCKET_BUFFER_SIZE];
+
+    int count = 0;
+    while (recv (ptr->info.sock_in, discarded, sizeof (discarded), 0) > 0)
+        ++count;
+
+    return count;
+}
+
+/**
+ * Returns \c 1 if both addresses point to the same host (the ports are not
+ * compared, since a host may answer from a different port)
+ */
+static int same_host (const DS_SocketAddress* a, const DS_SocketAddress* b)
+{
+    struct sockaddr_storage addr_a;
+    struct sockaddr_storage addr_b;
+
+    /* Addresses are not set */
+    if (a->len <= 0 || b->len <= 0)
+        return 0;
+
+    /* Copy the addresses to aligned structures */
+    memcpy (&addr_a, a->data, a->len);
+    memcpy (&addr_b, b->data, b->len);
+
+    /* Different families */
+    if (addr_a.ss_family != addr_b.ss_family)
+        return 0;
+
+    /* Compare IPv4 addresses */
+    if (addr_a.ss_family == AF_INET) {
+        struct sockaddr_in* in_a = (struct sockaddr_in*) &addr_a;
+        struct sockaddr_in* in_b = (struct sockaddr_in*) &addr_b;
+        return in_a->sin_addr.s_addr == in_b->sin_addr.s_addr;
+    }
+
+    /* Compare IPv6 addresses */
+    if (addr_a.ss_family == AF_INET6) {
+        struct sockaddr_in6* in_a = (struct sockaddr_in6*) &addr_a;
+        struct sockaddr_in6* in_b = (struct sockaddr_in6*) &addr_b;
+        return memcmp (&in_a->sin6_addr, &in_b->sin6_addr,
+                       sizeof (in_a->sin6_addr)) == 0;
+    }
+
+    return 0;
+}
+
+/**
+ * Connects the UDP client of the given socket to the given \a address,
+ * this function must be called with the reactor mutex locked
+ */
+static void use_address (DS_Socket* ptr, const DS_SocketAddress* address)
+{
+    struct sockaddr_storage addr;
+    memcpy (&addr, address->data, address->len);
+
+    ptr->info.remote = *address;
+    ptr->info.connected = (udp_connect (ptr->info.sock_out, &addr,
+                                        (socklen_t) address->len) == 0);
+}
+
+/**
+ * Checks if the given \a sender is one of the candidate addresses of the
+ * socket, if so, the socket will use that address from now on.
+ * This function must be called with the reactor mutex locked
+ *
+ * \returns \c 1 if the sender was one of the candidates
+ */
+static int select_sender (DS_Socket* ptr, const DS_SocketAddress* sender)
+{
+    int i;
+    for (i = 0; i < ptr->info.candidate_count; ++i) {
+        if (same_host (&ptr->info.candidates [i], sender)) {
+            use_address (ptr, &ptr->info.candidates [i]);
+            return 1;
+        }
     }
+
+    return 0;
 }
 
 /**
- * Runs the server socket loop, which uses the \c select() function
- * to copy received data into the socket's buffer only when the
- * operating system detects that the socket received some data.
+ * Copies the received datagrams into the queue of the given socket.
  *
- * \param ptr a pointer to a \c DS_Socket structure
+ * Each datagram gets its own queue slot, so that no packet is overwritten
+ * before the protocol can read it. If the queue is full, the oldest datagram
+ * is discarded and counted in the \c dropped field of the socket. If the
+ * reader still holds a view of the oldest datagram, the new datagrams are
+ * discarded instead.
  */
-static void server_loop (DS_Socket* ptr)
+static void read_socket (DS_Socket* ptr)
 {
     /* Check arguments */
     assert (ptr);
+    assert (ptr->info.queue);
+
+    int received = 0;
+    DS_SocketInfo* info = &ptr->info;
+    DS_SocketAddress senders [DS_SOCKET_QUEUE_SIZE];
+
+    /* The queue is full and its oldest datagram is being read */
+    if (info->queue_count >= DS_SOCKET_QUEUE_SIZE && info->borrowed) {
+        info->dropped += discard_datagrams (ptr);
+        return;
+    }
+
+    /* The socket is readable, so make room for at least one datagram */
+    if (info->queue_count >= DS_SOCKET_QUEUE_SIZE) {
+        info->queue_head = (info->queue_head + 1) % DS_SOCKET_QUEUE_SIZE;
+        info->queue_count -= 1;
+        info->dropped += 1;
+    }
+
+    /* Drain the socket until it is empty or the queue is full */
+    while (info->queue_count < DS_SOCKET_QUEUE_SIZE) {
+        int tail = (info->queue_head + info->queue_count) % DS_SOCKET_QUEUE_SIZE;
+        int slots = DS_Min (DS_SOCKET_QUEUE_SIZE - info->queue_count,
+                            DS_SOCKET_QUEUE_SIZE - tail);
+
+        /* Get the sender addresses while the remote host is unknown */
+        int i;
+        int probing = !info->connected && info->candidate_count > 1;
+        int count = receive_datagrams (ptr, tail, slots, probing ? senders : NULL);
+        info->queue_count += count;
+        received += count;
+
+        /* Use the first candidate that answered */
+        for (i = 0; probing && i < count; ++i) {
+            if (select_sender (ptr, &senders [i]))
+                break;
+        }
 
-    /* Initialize variables for select */
-    int rc, fd;
-    fd_set set;
-    struct timeval tv;
+        if (count < slots)
+            break;
+    }
+
+    /* Notify the reader that new data is available */
+    if (received > 0 && ready_callback)
+        ready_callback();
+}
 
-    /* Disable socket blocking */
-#ifndef _WIN32
-    set_socket_block (ptr->info.sock_in, 0);
+/**
+ * Returns the registered socket that uses the given input file descriptor,
+ * this function must be called with the reactor mutex locked
+ */
+static DS_Socket* find_socket (const int sfd)
+{
+    int i;
+    for (i = 0; i < socket_count; ++i) {
+        if (sockets [i]->info.sock_in == sfd)
+            return sockets [i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Creates a UDP socket that is connected to itself through the loopback
+ * interface. The reactor watches this socket together with the rest of
+ * the sockets, so that we can interrupt a blocking \c poll() call by
+ * sending a byte to it (this works on every platform, including Windows)
+ */
+static int create_wakeup_socket (void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof (addr);
+
+    /* Create the socket */
+    int sfd = socket (AF_INET, SOCK_DGRAM, 0);
+    if (sfd < 0)
+        return -1;
+
+    /* Bind to a random port in the loopback interface */
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if (bind (sfd, (struct sockaddr*) &addr, sizeof (addr)) != 0) {
+        socket_close (sfd);
+        return -1;
+    }
+
+    /* Connect the socket to itself */
+    if (getsockname (sfd, (struct sockaddr*) &addr, &len) != 0 ||
+        connect (sfd, (struct sockaddr*) &addr, len) != 0) {
+        socket_close (sfd);
+        return -1;
+    }
+
+    /* Never block while draining the socket */
+    set_socket_block (sfd, 0);
+
+    return sfd;
+}
+
+/**
+ * Interrupts the reactor thread, so that it re-reads the socket list
+ */
+static void wakeup_reactor (void)
+{
+    if (wakeup_sfd > 0)
+        send (wakeup_sfd, "", 1, 0);
+}
+
+/**
+ * Reads all the pending wake-up messages
+ */
+static void drain_wakeup_socket (void)
+{
+    char byte;
+    while (recv (wakeup_sfd, &byte, 1, 0) > 0);
+}
+
+/**
+ * Adds the given socket to the list of sockets watched by the reactor
+ */
+static void register_socket (DS_Socket* ptr)
+{
+    assert (ptr);
+
+    pthread_mutex_lock (&reactor_mutex);
+
+    /* Add the socket to the list (only if it is not already there) */
+    int i, found = 0;
+    for (i = 0; i < socket_count; ++i)
+        found |= (sockets [i] == ptr);
+
+    if (!found && socket_count < MAX_SOCKETS) {
+        sockets [socket_count] = ptr;
+        ++socket_count;
+
+#if defined USE_EPOLL
+        struct epoll_event event;
+        memset (&event, 0, sizeof (event));
+        event.events = EPOLLIN;
+        event.data.fd = ptr->info.sock_in;
+        epoll_ctl (epoll_fd, EPOLL_CTL_ADD, ptr->info.sock_in, &event);
+#endif
+    }
+
+    pthread_mutex_unlock (&reactor_mutex);
+
+    /* Let the reactor know about the new socket */
+    wakeup_reactor();
+}
+
+/**
+ * Removes the given socket from the list of sockets watched by the reactor.
+ * Once this function returns, the reactor will not access the socket anymore.
+ */
+static void unregister_socket (DS_Socket* ptr)
+{
+    assert (ptr);
+
+    pthread_mutex_lock (&reactor_mutex);
+
+    int i;
+    for (i = 0; i < socket_count; ++i) {
+        if (sockets [i] == ptr) {
+#if defined USE_EPOLL
+            struct epoll_event event;
+            memset (&event, 0, sizeof (event));
+            epoll_ctl (epoll_fd, EPOLL_CTL_DEL, ptr->info.sock_in, &event);
 #endif
 
-    /* Run the server while the socket is valid */
-    while (ptr->info.server_init && ptr->info.sock_in > 0) {
-        tv.tv_sec = 0;
-        tv.tv_usec = 5000 * 100;
+            --socket_count;
+            sockets [i] = sockets [socket_count];
+            break;
+        }
+    }
+
+    pthread_mutex_unlock (&reactor_mutex);
+
+    /* Let the reactor know that the socket is gone */
+    wakeup_reactor();
+}
+
+/**
+ * Runs the reactor loop, which waits (without timeout) until any of the
+ * open sockets receives data and copies the data into the socket's buffer.
+ * We use \c epoll() on Linux and \c poll() on the rest of the platforms.
+ */
+static void* run_reactor (void* data)
+{
+    (void) data;
+
+#if defined USE_EPOLL
+    struct epoll_event events [MAX_SOCKETS + 1];
 
-        FD_ZERO (&set);
-        FD_SET (ptr->info.sock_in, &set);
+    while (reactor_running) {
+        /* Wait for incoming data */
+        int i, count = epoll_wait (epoll_fd, events, MAX_SOCKETS + 1, -1);
 
-#if defined _WIN32
-        fd = 0;
+        /* Read data from each ready socket */
+        pthread_mutex_lock (&reactor_mutex);
+        for (i = 0; i < count; ++i) {
+            if (events [i].data.fd == wakeup_sfd)
+                drain_wakeup_socket();
+
+            else {
+                DS_Socket* ptr = find_socket (events [i].data.fd);
+                if (ptr)
+                    read_socket (ptr);
+            }
+        }
+        pthread_mutex_unlock (&reactor_mutex);
+    }
 #else
-        fd = ptr->info.sock_in + 1;
+    struct pollfd fds [MAX_SOCKETS + 1];
+
+    while (reactor_running) {
+        /* Get the list of file descriptors to watch */
+        int i, count = 1;
+        pthread_mutex_lock (&reactor_mutex);
+        fds [0].fd = wakeup_sfd;
+        fds [0].events = POLLIN;
+        fds [0].revents = 0;
+        for (i = 0; i < socket_count; ++i) {
+            fds [count].fd = sockets [i]->info.sock_in;
+            fds [count].events = POLLIN;
+            fds [count].revents = 0;
+            ++count;
+        }
+        pthread_mutex_unlock (&reactor_mutex);
+
+        /* Wait for incoming data */
+        if (poll (fds, count, -1) <= 0)
+            continue;
+
+        /* Read data from each ready socket */
+        pthread_mutex_lock (&reactor_mutex);
+        if (fds [0].revents & POLLIN)
+            drain_wakeup_socket();
+
+        for (i = 1; i < count; ++i) {
+            if (fds [i].revents & POLLIN) {
+                DS_Socket* ptr = find_socket (fds [i].fd);
+                if (ptr)
+                    read_socket (ptr);
+            }
+        }
+        pthread_mutex_unlock (&reactor_mutex);
+    }
 #endif
 
-        rc = select (fd, &set, NULL, NULL, &tv);
-        if (rc > 0 && FD_ISSET (ptr->info.sock_in, &set))
-            read_socket (ptr);
+    return NULL;
+}
+
+/**
+ * Disconnects the UDP client of the given socket and forgets its remote
+ * and candidate addresses, this function must be called with the reactor
+ * mutex locked
+ */
+static void forget_addresses (DS_Socket* ptr)
+{
+    ptr->info.connected = 0;
+    memset (&ptr->info.remote, 0, sizeof (ptr->info.remote));
+    memset (ptr->info.candidates, 0, sizeof (ptr->info.candidates));
+    udp_disconnect (ptr->info.sock_out);
+}
+
+/**
+ * Called by the resolver when one of the candidate addresses of a socket
+ * has been resolved. The first result of a new generation replaces the
+ * previous addresses of the socket. If the socket only has one candidate,
+ * its client is connected to it immediately, otherwise, the socket sends
+ * its data to every candidate until one of them answers.
+ */
+static void on_address_resolved (void* data, const int generation,
+                                 const int index, const void* addr,
+                                 const int addr_len)
+{
+    DS_Socket* ptr = (DS_Socket*) data;
+
+    /* Lookup failed */
+    if (!addr || addr_len <= 0 || addr_len > DS_SOCKET_ADDR_SIZE)
+        return;
+
+    pthread_mutex_lock (&reactor_mutex);
+
+    /* Ignore results for old addresses or closed sockets */
+    if (ptr->info.generation == generation && ptr->info.client_init &&
+            index < ptr->info.lookup_count) {
+        /* Stop using the previous addresses */
+        if (ptr->info.stale) {
+            forget_addresses (ptr);
+            ptr->info.stale = 0;
+            ptr->info.candidate_count = ptr->info.lookup_count;
+        }
+
+        DS_SocketAddress* candidate = &ptr->info.candidates [index];
+        memcpy (candidate->data, addr, addr_len);
+        candidate->len = addr_len;
+
+        if (ptr->info.candidate_count == 1)
+            use_address (ptr, candidate);
+    }
+
+    pthread_mutex_unlock (&reactor_mutex);
+}
+
+/**
+ * Resolves the given \a hosts in the background, the socket keeps sending
+ * its data to the previous addresses until the first of the new addresses
+ * is resolved (numeric addresses are resolved immediately). This is only
+ * done when the socket is opened or its address changes (e.g. when a
+ * watchdog expires).
+ */
+static void resolve_addresses (DS_Socket* ptr, const char** hosts, const int count)
+{
+    /* Check arguments */
+    assert (ptr);
+    assert (count <= DS_SOCKET_CANDIDATES);
+
+    int i;
+    int generation;
+
+    /* Replace the previous addresses once a new address is resolved */
+    pthread_mutex_lock (&reactor_mutex);
+    generation = ++next_generation;
+    ptr->info.stale = 1;
+    ptr->info.generation = generation;
+    ptr->info.lookup_count = count;
+
+    /* There is nothing to resolve */
+    if (count <= 0) {
+        forget_addresses (ptr);
+        ptr->info.stale = 0;
+        ptr->info.candidate_count = 0;
+    }
+    pthread_mutex_unlock (&reactor_mutex);
+
+    /* Resolve every candidate in parallel */
+    for (i = 0; i < count; ++i)
+        DS_ResolverLookup (hosts [i], ptr->info.out_service,
+                           &on_address_resolved, ptr, generation, i);
+}
+
+/**
+ * Sends the given data to the given \a address of the socket.
+ * This function must be called with the reactor mutex locked
+ *
+ * \returns number of bytes written on success, -1 on failure
+ */
+static int send_datagram (const DS_Socket* ptr,
+                          const DS_SocketAddress* address,
+                          const char* data, const int len)
+{
+    /* Use the connected socket */
+    if (ptr->info.connected)
+        return udp_send (ptr->info.sock_out, data, len, 0);
+
+    /* Send the datagram to the given address */
+    struct sockaddr_storage addr;
+    memcpy (&addr, address->data, address->len);
+    return udp_sendto_addr (ptr->info.sock_out, data, len,
+                            &addr, (socklen_t) address->len, 0);
+}
+
+/**
+ * Returns \c 1 if the candidate at the given \a index has not been resolved
+ * yet or if it has the same address as a previous candidate, this is used
+ * to avoid sending the same packet twice to the same address
+ */
+static int skip_candidate (const DS_Socket* ptr, const int index)
+{
+    int i;
+    const DS_SocketAddress* candidate = &ptr->info.candidates [index];
+
+    /* Address not resolved yet */
+    if (candidate->len <= 0)
+        return 1;
+
+    /* Same address as a previous candidate */
+    for (i = 0; i < index; ++i) {
+        if (ptr->info.candidates [i].len == candidate->len &&
+                memcmp (ptr->info.candidates [i].data, candidate->data,
+                        candidate->len) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Sends the given data to every resolved candidate address of the socket,
+ * this is used until one of the candidates answers.
+ * This function must be called with the reactor mutex locked
+ *
+ * \returns number of bytes written on success, -1 on failure
+ */
+static int send_to_candidates (const DS_Socket* ptr, const char* data, const int len)
+{
+    int i;
+    int bytes = -1;
+
+    for (i = 0; i < ptr->info.candidate_count; ++i) {
+        if (!skip_candidate (ptr, i)) {
+            int sent = send_datagram (ptr, &ptr->info.candidates [i], data, len);
+            bytes = DS_Max (bytes, sent);
+        }
     }
+
+    return bytes;
 }
 
 /**
  * Initializes the given socket structure
  *
- * \param data raw pointer to a \c DS_Socket structure
+ * \param ptr pointer to a \c DS_Socket structure
  */
-static void* create_socket (void* data)
+static void create_socket (DS_Socket* ptr)
 {
     /* Check arguments */
-    assert (data);
-    DS_Socket* ptr = (DS_Socket*) data;
+    assert (ptr);
 
-    /* Ensure that buffer and service strings are set to 0 */
-    memset (ptr->info.buffer, 0, sizeof (ptr->info.buffer));
+    /* Ensure that service strings are set to 0 */
     memset (ptr->info.in_service, 0, sizeof (ptr->info.in_service));
     memset (ptr->info.out_service, 0, sizeof (ptr->info.out_service));
 
+    /* Allocate the datagram queue */
+    ptr->info.dropped = 0;
+    ptr->info.queue_head = 0;
+    ptr->info.queue_count = 0;
+    ptr->info.borrowed = 0;
+    if (!ptr->info.queue)
+        ptr->info.queue = (DS_Datagram*) calloc (DS_SOCKET_QUEUE_SIZE,
+                                                 sizeof (DS_Datagram));
+
     /* Set service strings */
     int len = sizeof (ptr->info.in_service);
     SPRINTF_S (ptr->info.in_service, len, "%d", ptr->in_port);
@@ -147,11 +755,17 @@ static void* create_socket (void* data)
     ptr->info.server_init = (ptr->info.sock_in > 0);
     ptr->info.client_init = (ptr->info.sock_out > 0);
 
-    /* Start server loop */
-    server_loop (ptr);
+    /* Resolve the remote host in the background */
+    if (ptr->type == DS_SOCKET_UDP && ptr->info.client_init) {
+        const char* address = ptr->address;
+        resolve_addresses (ptr, &address, strlen (address) > 0 ? 1 : 0);
+    }
 
-    /* Exit */
-    return NULL;
+    /* Let the reactor watch the server socket */
+    if (ptr->info.server_init) {
+        set_socket_block (ptr->info.sock_in, 0);
+        register_socket (ptr);
+    }
 }
 
 /**
@@ -172,13 +786,22 @@ DS_Socket* DS_SocketEmpty (void)
     /* Fill socket info structure */
     socket->info.sock_in = 0;
     socket->info.sock_out = 0;
-    socket->info.buffer_size = 0;
+    socket->info.dropped = 0;
+    socket->info.queue = NULL;
+    socket->info.retired = NULL;
+    socket->info.queue_head = 0;
+    socket->info.queue_count = 0;
+    socket->info.borrowed = 0;
     socket->info.server_init = 0;
     socket->info.client_init = 0;
+    socket->info.connected = 0;
+    socket->info.generation = 0;
+    socket->info.candidate_count = 0;
+    socket->info.lookup_count = 0;
+    socket->info.stale = 0;
 
     /* Fill strings with 0 */
     memset (socket->address, 0, sizeof (socket->address));
-    memset (socket->info.buffer, 0, sizeof (socket->info.buffer));
     memset (socket->info.in_service, 0, sizeof (socket->info.in_service));
     memset (socket->info.out_service, 0, sizeof (socket->info.out_service));
 
@@ -187,26 +810,97 @@ DS_Socket* DS_SocketEmpty (void)
 }
 
 /**
- * Initializes the sockets module and its event system
+ * Initializes the sockets module and starts the reactor thread
  */
 void Sockets_Init (void)
 {
     sockets_init (1);
+    Resolver_Init();
+
+    /* Reset the socket list */
+    socket_count = 0;
+    memset (sockets, 0, sizeof (sockets));
+
+    /* Create the wake-up socket */
+    wakeup_sfd = create_wakeup_socket();
+    assert (wakeup_sfd > 0);
+
+    /* Create the epoll instance and watch the wake-up socket */
+#if defined USE_EPOLL
+    struct epoll_event event;
+    memset (&event, 0, sizeof (event));
+    event.events = EPOLLIN;
+    event.data.fd = wakeup_sfd;
+    epoll_fd = epoll_create (MAX_SOCKETS + 1);
+    epoll_ctl (epoll_fd, EPOLL_CTL_ADD, wakeup_sfd, &event);
+    assert (epoll_fd >= 0);
+#endif
+
+    /* Start the reactor thread */
+    reactor_running = 1;
+    int error = pthread_create (&reactor_thread, NULL, &run_reactor, NULL);
+
+    /* Warn the user when the reactor cannot start */
+    if (error) {
+        DS_String caption = DS_StrNew ("LibDS");
+        DS_String message = DS_StrNew ("Cannot start socket thread!");
+        DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
+        DS_StrRmBuf (&caption);
+        DS_StrRmBuf (&message);
+    }
+
+    /* Quit if the reactor cannot start */
+    assert (!error);
 }
 
 /**
- * Stops the event loops and closes all socket structures
+ * Stops the reactor thread and closes the sockets module
  */
 void Sockets_Close (void)
 {
+    /* Stop the resolver threads */
+    Resolver_Close();
+
+    /* Stop the reactor thread */
+    reactor_running = 0;
+    wakeup_reactor();
+    pthread_join (reactor_thread, NULL);
+
+    /* Close the wake-up socket and the epoll instance */
+    pthread_mutex_lock (&reactor_mutex);
+    socket_close (wakeup_sfd);
+    wakeup_sfd = -1;
+#if defined USE_EPOLL
+    close (epoll_fd);
+    epoll_fd = -1;
+#endif
+    pthread_mutex_unlock (&reactor_mutex);
+
     sockets_exit();
 }
 
+/**
+ * Registers a function that will be called (from the reactor thread) every
+ * time that a socket receives new data. This allows the protocol event loop
+ * to sleep until there is something to read.
+ *
+ * The callback is called with the reactor mutex locked, so once this
+ * function returns, the previous callback is not running anymore.
+ *
+ * \param callback the function to call, or \c NULL to disable notifications
+ */
+void DS_SocketSetReadyCallback (void (*callback) (void))
+{
+    pthread_mutex_lock (&reactor_mutex);
+    ready_callback = callback;
+    pthread_mutex_unlock (&reactor_mutex);
+}
+
 /**
  * Initializes and configures the given socket
  *
- * \note The socket will be initialzed in another thread to avoid blocking
- *       the main thread of the application
+ * \note The socket is not read in its own thread, instead, the reactor
+ *       thread of this module waits for incoming data on all the sockets
  */
 void DS_SocketOpen (DS_Socket* ptr)
 {
@@ -217,22 +911,8 @@ void DS_SocketOpen (DS_Socket* ptr)
     if (ptr->disabled)
         return;
 
-    /* Initialize the socket in another thread */
-    pthread_t thread;
-    int error = pthread_create (&thread, NULL,
-                                &create_socket, (void*) ptr);
-
-    /* Warn the user when the socket cannot start */
-    if (error) {
-        DS_String caption = DS_StrNew ("LibDS");
-        DS_String message = DS_StrNew ("Cannot start socket thread!");
-        DS_ShowMessageBox (&caption, &message, DS_ICON_ERROR);
-        DS_StrRmBuf (&caption);
-        DS_StrRmBuf (&message);
-    }
-
-    /* Quit if socket cannot start */
-    assert (!error);
+    /* Initialize the socket */
+    create_socket (ptr);
 }
 
 /**
@@ -246,9 +926,20 @@ void DS_SocketClose (DS_Socket* ptr)
     /* Check arguments */
     assert (ptr);
 
-    /* Reset socket properties */
+    /* Stop watching the socket */
+    unregister_socket (ptr);
+
+    /* Reset socket properties and ignore pending lookups */
+    pthread_mutex_lock (&reactor_mutex);
+    ptr->info.connected = 0;
     ptr->info.server_init = 0;
     ptr->info.client_init = 0;
+    ptr->info.stale = 0;
+    ptr->info.lookup_count = 0;
+    ptr->info.candidate_count = 0;
+    ptr->info.generation = ++next_generation;
+    memset (&ptr->info.remote, 0, sizeof (ptr->info.remote));
+    pthread_mutex_unlock (&reactor_mutex);
 
     /* Close sockets */
 #if defined (__ANDROID__)
@@ -262,48 +953,318 @@ void DS_SocketClose (DS_Socket* ptr)
     /* Reset socket information structure */
     ptr->info.sock_in = -1;
     ptr->info.sock_out = -1;
-    ptr->info.buffer_size = 0;
+
+    /* Delete the datagram queue, if the reader is still parsing a datagram,
+     * the queue is freed when the reader releases its view */
+    pthread_mutex_lock (&reactor_mutex);
+    if (ptr->info.borrowed) {
+        DS_FREE (ptr->info.retired);
+        ptr->info.retired = ptr->info.queue;
+        ptr->info.queue = NULL;
+    }
+
+    else {
+        DS_FREE (ptr->info.queue);
+        DS_FREE (ptr->info.retired);
+    }
+
+    ptr->info.queue_head = 0;
+    ptr->info.queue_count = 0;
+    ptr->info.borrowed = 0;
+    pthread_mutex_unlock (&reactor_mutex);
 
     /* Reset strings */
-    memset (ptr->info.buffer, 0, sizeof (ptr->info.buffer));
     memset (ptr->info.in_service, 0, sizeof (ptr->info.in_service));
     memset (ptr->info.out_service, 0, sizeof (ptr->info.out_service));
 }
 
 /**
- * Returns any data received by the given socket
+ * Removes the datagram that the reader was holding from the queue of the
+ * given socket, so that the reactor can write into its slot again
+ *
+ * \warning The reactor mutex must be locked before calling this function
+ */
+static void release_view (DS_Socket* ptr)
+{
+    if (ptr->info.borrowed && ptr->info.queue_count > 0) {
+        ptr->info.queue_head = (ptr->info.queue_head + 1) % DS_SOCKET_QUEUE_SIZE;
+        ptr->info.queue_count -= 1;
+    }
+
+    /* The socket was closed while the view was held, free its old queue */
+    DS_FREE (ptr->info.retired);
+    ptr->info.borrowed = 0;
+}
+
+/**
+ * Points the given \a view to the oldest datagram received by the given
+ * socket, without copying or allocating anything. The datagram is removed
+ * from the queue on the next read, so the view is only valid until the next
+ * call to \c DS_SocketReadView() or \c DS_SocketRead() with the same socket.
+ *
+ * Call this function until it returns \c 0 to read every received datagram,
+ * the view must not be freed with \c DS_StrRmBuf().
  *
  * \param ptr pointer to a \c DS_Socket structure
+ * \param view the string that will point to the datagram data
+ *
+ * \returns 1 if a datagram was available, 0 if the queue is empty
  */
-DS_String DS_SocketRead (DS_Socket* ptr)
+int DS_SocketReadView (DS_Socket* ptr, DS_String* view)
 {
     /* Check arguments */
     assert (ptr);
+    assert (view);
+
+    /* Clear the view */
+    view->buf = NULL;
+    view->len = 0;
+    view->cap = 0;
+
+    /* Release the previous datagram */
+    pthread_mutex_lock (&reactor_mutex);
+    release_view (ptr);
 
     /* Socket is disabled or uninitialized */
-    if ((ptr->info.server_init == 0) || (ptr->disabled == 1))
+    if ((ptr->info.server_init == 0) || (ptr->disabled == 1)) {
+        pthread_mutex_unlock (&reactor_mutex);
+        return 0;
+    }
+
+    /* Point the view to the oldest (non-empty) datagram */
+    while (ptr->info.queue && ptr->info.queue_count > 0) {
+        DS_Datagram* datagram = &ptr->info.queue [ptr->info.queue_head];
+
+        /* Skip empty datagrams */
+        if (datagram->size <= 0) {
+            ptr->info.queue_head = (ptr->info.queue_head + 1) % DS_SOCKET_QUEUE_SIZE;
+            ptr->info.queue_count -= 1;
+            continue;
+        }
+
+        /* Keep the slot until the next read */
+        view->buf = datagram->data;
+        view->len = (size_t) datagram->size;
+        ptr->info.borrowed = 1;
+
+        pthread_mutex_unlock (&reactor_mutex);
+        return 1;
+    }
+    pthread_mutex_unlock (&reactor_mutex);
+
+    return 0;
+}
+
+/**
+ * Returns a copy of the oldest datagram received by the given socket and
+ * removes it from the socket's queue. Call this function until it returns an
+ * empty string to read every received datagram.
+ *
+ * \note Use \c DS_SocketReadView() to avoid allocating a new string
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ */
+DS_String DS_SocketRead (DS_Socket* ptr)
+{
+    /* Check arguments */
+    assert (ptr);
+
+    /* Get the oldest datagram */
+    DS_String view;
+    if (!DS_SocketReadView (ptr, &view))
         return DS_StrNewLen (0);
 
-    /* Copy the current buffer and clear it */
-    if (ptr->info.buffer_size > 0) {
-        DS_String buffer = DS_StrNewLen (ptr->info.buffer_size);
+    /* Copy the datagram and remove it from the queue */
+    DS_String buffer = DS_StrDup (&view);
+    pthread_mutex_lock (&reactor_mutex);
+    release_view (ptr);
+    pthread_mutex_unlock (&reactor_mutex);
 
-        /* Copy buffer to string */
+    return buffer;
+}
+
+/**
+ * Returns the number of datagrams that the given socket discarded because
+ * they were not read before the socket's queue was full, and resets it.
+ * The protocol module adds this number to the statistics of the link.
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ */
+unsigned long DS_SocketTakeDropped (DS_Socket* ptr)
+{
+    assert (ptr);
+
+    pthread_mutex_lock (&reactor_mutex);
+    unsigned long dropped = ptr->info.dropped;
+    ptr->info.dropped = 0;
+    pthread_mutex_unlock (&reactor_mutex);
+
+    return dropped;
+}
+
+
+#if defined USE_SENDMMSG
+/**
+ * Sends the given \a count messages through the given socket, the kernel may
+ * send less messages than requested, so we call \c sendmmsg() until every
+ * message has been sent or has failed. The number of bytes sent for each
+ * message (or \c -1 on failure) is written to \a results.
+ */
+static void send_messages (const int sfd, struct mmsghdr* msgs, const int count,
+                           int* results)
+{
+    int sent = 0;
+    int retried = 0;
+
+    while (sent < count) {
         int i;
-        for (i = 0; i < (int) ptr->info.buffer_size; ++i)
-            DS_StrSetChar (&buffer, i, ptr->info.buffer [i]);
+        int sent_now = sendmmsg (sfd, msgs + sent, count - sent, 0);
+
+        /* Save the number of bytes sent for each message */
+        if (sent_now > 0) {
+            for (i = sent; i < sent + sent_now; ++i)
+                results [i] = (int) msgs [i].msg_len;
+
+            sent += sent_now;
+            retried = 0;
+            continue;
+        }
+
+        /* An earlier datagram was refused by the remote host (ICMP port
+         * unreachable), the error is cleared now, so try again */
+        if (sent_now < 0 && errno == ECONNREFUSED && !retried) {
+            retried = 1;
+            continue;
+        }
+
+        /* The next message cannot be sent, skip it */
+        results [sent] = -1;
+        retried = 0;
+        ++sent;
+    }
+}
+
+/**
+ * Sends every queued datagram (using a single system call for each socket)
+ * and reports the number of bytes sent for each queued packet
+ */
+static void flush_batch (void)
+{
+    int i;
+    int j;
+    int results [MAX_BATCH];
+    int handled [MAX_BATCH];
+    struct iovec iovecs [MAX_BATCH];
+    struct mmsghdr msgs [MAX_BATCH];
+    memset (handled, 0, sizeof (handled));
+
+    /* Send the datagrams, grouped by socket */
+    pthread_mutex_lock (&reactor_mutex);
+    for (i = 0; i < batch_count; ++i) {
+        int count = 0;
+        int indexes [MAX_BATCH];
+
+        if (handled [i])
+            continue;
+
+        /* Get the datagrams of this socket */
+        memset (msgs, 0, sizeof (msgs));
+        for (j = i; j < batch_count; ++j) {
+            BatchDatagram* datagram = &batch [j];
+            if (handled [j] || datagram->sfd != batch [i].sfd)
+                continue;
+
+            iovecs [count].iov_base = datagram->data;
+            iovecs [count].iov_len = datagram->size;
+            msgs [count].msg_hdr.msg_iov = &iovecs [count];
+            msgs [count].msg_hdr.msg_iovlen = 1;
+
+            /* Connected sockets do not need the address */
+            if (!datagram->connected) {
+                msgs [count].msg_hdr.msg_name = datagram->address.data;
+                msgs [count].msg_hdr.msg_namelen = datagram->address.len;
+            }
+
+            handled [j] = 1;
+            indexes [count] = j;
+            ++count;
+        }
 
-        /* Clear buffer info */
-        memset (ptr->info.buffer, 0, ptr->info.buffer_size);
-        ptr->info.buffer_size = 0;
+        /* Send them and register the results of each packet */
+        send_messages (batch [i].sfd, msgs, count, results);
+        for (j = 0; j < count; ++j) {
+            BatchPacket* packet = &batch_packets [batch [indexes [j]].packet];
+            packet->bytes = DS_Max (packet->bytes, results [j]);
+        }
+    }
+    pthread_mutex_unlock (&reactor_mutex);
 
-        /* Return copied buffer */
-        return buffer;
+    /* Report the results (without holding the mutex) */
+    for (i = 0; i < packet_count; ++i) {
+        if (batch_packets [i].callback)
+            batch_packets [i].callback (batch_packets [i].data,
+                                        batch_packets [i].bytes);
     }
 
-    return DS_StrNewLen (0);
+    batch_count = 0;
+    packet_count = 0;
+}
+
+/**
+ * Copies the given datagram to the batch, the datagram is sent through the
+ * output socket of \a ptr (to the given \a address if the socket is not
+ * connected). This function must be called with the reactor mutex locked
+ */
+static void queue_datagram (const DS_Socket* ptr,
+                            const DS_SocketAddress* address,
+                            const char* data, const int len)
+{
+    BatchDatagram* datagram = &batch [batch_count];
+
+    datagram->size = len;
+    datagram->address = *address;
+    datagram->packet = packet_count - 1;
+    datagram->sfd = ptr->info.sock_out;
+    datagram->connected = ptr->info.connected;
+    memcpy (datagram->data, data, len);
+
+    ++batch_count;
+}
+#endif
+
+/**
+ * Starts queuing the UDP datagrams sent by the calling thread with
+ * \c DS_SocketQueueBytes(), so that they can be sent together with
+ * \c DS_SocketBatchFlush(). This is used to send every packet that is due
+ * in the same tick with as few system calls as possible.
+ *
+ * \note Batching is only available on Linux (with \c sendmmsg()), on the rest
+ *       of the platforms, this function does nothing and datagrams are
+ *       sent immediately
+ */
+void DS_SocketBatchBegin (void)
+{
+#if defined USE_SENDMMSG
+    batch_count = 0;
+    packet_count = 0;
+    batch_active = 1;
+    batch_thread = pthread_self();
+#endif
 }
 
+/**
+ * Sends every datagram queued since the last call to \c DS_SocketBatchBegin()
+ * and stops queuing datagrams
+ */
+void DS_SocketBatchFlush (void)
+{
+#if defined USE_SENDMMSG
+    if (batch_active) {
+        flush_batch();
+        batch_active = 0;
+    }
+#endif
+}
 
 /**
  * Sends the given \a data using the given socket
@@ -319,36 +1280,121 @@ int DS_SocketSend (const DS_Socket* ptr, const DS_String* data)
     assert (ptr);
     assert (data);
 
+    /* Send the string buffer directly */
+    return DS_SocketSendBytes (ptr, data->buf, DS_StrLen (data));
+}
+
+/**
+ * Sends \a len bytes of the given \a data using the given socket, this
+ * function does not copy the data
+ *
+ * \param ptr pointer to the socket to use to send the given \a data
+ * \param data the data buffer to send
+ * \param len the number of bytes to send
+ *
+ * \returns number of bytes written on success, -1 on failure
+ */
+int DS_SocketSendBytes (const DS_Socket* ptr, const void* data, const int len)
+{
+    /* Check arguments */
+    assert (ptr);
+    assert (data || len <= 0);
+
     /* Socket is disabled or uninitialized */
     if ((ptr->info.client_init == 0) || ptr->disabled)
         return -1;
 
     /* Data is empty */
-    if (DS_StrEmpty (data))
+    if (len <= 0)
         return 0;
 
     /* Initialize variables*/
     int bytes_written = 0;
-    int len = DS_StrLen (data);
-    char* bytes = DS_StrToChar (data);
+    const char* bytes = (const char*) data;
 
     /* Send data using TCP */
     if (ptr->type == DS_SOCKET_TCP)
         bytes_written = send (ptr->info.sock_out, bytes, len, 0);
 
-    /* Send data using UDP */
+    /* Send data using UDP (only if the remote host was resolved) */
     else if (ptr->type == DS_SOCKET_UDP) {
-        bytes_written = udp_sendto (ptr->info.sock_out, bytes, len,
-                                    ptr->address, ptr->info.out_service, 0);
+        pthread_mutex_lock (&reactor_mutex);
+        if (ptr->info.connected)
+            bytes_written = send_datagram (ptr, &ptr->info.remote, bytes, len);
+        else
+            bytes_written = send_to_candidates (ptr, bytes, len);
+        pthread_mutex_unlock (&reactor_mutex);
     }
 
-    /* Delete temp. buffer */
-    DS_FREE (bytes);
-
     /* Return error code */
     return bytes_written;
 }
 
+/**
+ * Sends \a len bytes of the given \a data using the given socket and calls
+ * the given \a callback with the number of bytes sent (or \c -1 on failure).
+ *
+ * If the calling thread has started a batch, the data is copied and sent when
+ * the batch is flushed, otherwise, the data is sent immediately. In both
+ * cases, the \a callback is called once the data has been sent.
+ *
+ * \param ptr pointer to the socket to use to send the given \a data
+ * \param data the data buffer to send
+ * \param len the number of bytes to send
+ * \param callback the function to call once the data is sent (optional)
+ * \param callback_data the first argument given to the \a callback
+ */
+void DS_SocketQueueBytes (const DS_Socket* ptr, const void* data,
+                          const int len, DS_SocketSentCallback callback,
+                          void* callback_data)
+{
+    /* Check arguments */
+    assert (ptr);
+    assert (data || len <= 0);
+
+#if defined USE_SENDMMSG
+    int i;
+    int batched = batch_active && pthread_equal (batch_thread, pthread_self());
+
+    /* Queue the UDP datagrams (one for each address) */
+    if (batched && ptr->type == DS_SOCKET_UDP && ptr->info.client_init &&
+            !ptr->disabled && len > 0 && len <= DS_SOCKET_BUFFER_SIZE) {
+        /* Make room for the packet */
+        if (packet_count >= MAX_BATCH ||
+                batch_count + DS_SOCKET_CANDIDATES > MAX_BATCH)
+            flush_batch();
+
+        /* Register the packet */
+        BatchPacket* packet = &batch_packets [packet_count];
+        packet->bytes = -1;
+        packet->data = callback_data;
+        packet->callback = callback;
+        ++packet_count;
+
+        /* Queue the datagrams */
+        pthread_mutex_lock (&reactor_mutex);
+        if (ptr->info.connected)
+            queue_datagram (ptr, &ptr->info.remote, (const char*) data, len);
+
+        else {
+            for (i = 0; i < ptr->info.candidate_count; ++i) {
+                if (!skip_candidate (ptr, i))
+                    queue_datagram (ptr, &ptr->info.candidates [i],
+                                    (const char*) data, len);
+            }
+        }
+        pthread_mutex_unlock (&reactor_mutex);
+
+        return;
+    }
+#endif
+
+    /* Send the data immediately */
+    int bytes = DS_SocketSendBytes (ptr, data, len);
+    if (callback)
+        callback (callback_data, bytes);
+}
+
 /**
  * Changes the \a address of the given socket structre
  *
@@ -364,9 +1410,60 @@ void DS_SocketChangeAddress (DS_Socket* ptr, const char* address)
     if (!address)
         return;
 
+    /* Apply the address */
+    DS_SocketChangeAddresses (ptr, &address, 1);
+}
+
+/**
+ * Changes the address of the given socket to the first of the given
+ * \a addresses that answers. All the addresses are resolved in parallel
+ * and the socket sends its data to each of them until a packet is received
+ * from one of them (e.g. the mDNS name, static IP and USB address of a robot).
+ *
+ * \note TCP sockets only use the first address
+ *
+ * \param ptr pointer to a \c DS_Socket structure
+ * \param addresses the list of candidate addresses
+ * \param count the number of addresses in the list
+ */
+void DS_SocketChangeAddresses (DS_Socket* ptr, const char** addresses, const int count)
+{
+    /* Check arguments */
+    assert (ptr);
+    assert (addresses);
+
+    /* Abort if there are no addresses */
+    if (count <= 0 || !addresses [0])
+        return;
+
+    /* Get the non-empty, unique addresses */
+    int i;
+    int j;
+    int hosts_count = 0;
+    const char* hosts [DS_SOCKET_CANDIDATES];
+    for (i = 0; i < count && hosts_count < DS_SOCKET_CANDIDATES; ++i) {
+        if (!addresses [i] || strlen (addresses [i]) == 0)
+            continue;
+
+        for (j = 0; j < hosts_count; ++j) {
+            if (strcmp (hosts [j], addresses [i]) == 0)
+                break;
+        }
+
+        if (j == hosts_count)
+            hosts [hosts_count++] = addresses [i];
+    }
+
     /* Re-assign the address */
     memset (ptr->address, 0, sizeof (ptr->address));
-    memcpy (ptr->address, address, strlen (address));
+    memcpy (ptr->address, addresses [0],
+            DS_Min (strlen (addresses [0]), sizeof (ptr->address) - 1));
+
+    /* UDP socket is open, resolve the new addresses and keep the server socket */
+    if (ptr->type == DS_SOCKET_UDP && ptr->info.client_init && !ptr->disabled) {
+        resolve_addresses (ptr, hosts, hosts_count);
+        return;
+    }
 
     /* Re-open the socket */
     DS_SocketClose (ptr);
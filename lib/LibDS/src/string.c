@@ -29,6 +29,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * Minimum number of bytes allocated when a string needs to grow
+ */
+#define MIN_CAPACITY 16
+
 #define SPRINTF_S snprintf
 #ifdef _WIN32
     #ifndef __MINGW32__
@@ -106,6 +111,7 @@ int DS_StrRmBuf (DS_String* string)
     /* Delete the buffer */
     if (string->buf != NULL) {
         string->len = 0;
+        string->cap = 0;
         free (string->buf);
         string->buf = NULL;
         return DS_STR_SUCCESS;
@@ -116,7 +122,41 @@ int DS_StrRmBuf (DS_String* string)
 }
 
 /**
- * Resizes the given \a string to the given \a size
+ * Ensures that the buffer of the given \a string can hold at least \a size
+ * bytes without being reallocated. The capacity grows geometrically, so that
+ * appending N bytes one by one only costs O(N) copies.
+ *
+ * \note The length of the string is not changed by this function
+ *
+ * \warning The program will quit if \a string is \c NULL
+ */
+int DS_StrReserve (DS_String* string, size_t size)
+{
+    /* Check arguments */
+    assert (string);
+
+    /* Buffer is already large enough */
+    if (size <= string->cap && string->buf)
+        return DS_STR_SUCCESS;
+
+    /* Double the capacity until the requested size fits */
+    size_t capacity = string->cap > MIN_CAPACITY ? string->cap : MIN_CAPACITY;
+    while (capacity < size)
+        capacity *= 2;
+
+    /* Grow the buffer, the old buffer stays valid if realloc fails */
+    char* buf = (char*) realloc (string->buf, capacity);
+    if (!buf)
+        return DS_STR_FAILURE;
+
+    /* Update the string */
+    string->buf = buf;
+    string->cap = capacity;
+    return DS_STR_SUCCESS;
+}
+
+/**
+ * Resizes the given \a string to the given \a size, new bytes are set to 0
  *
  * \param string the original string structure
  * \param size the new size to apply to the string
@@ -130,32 +170,17 @@ int DS_StrResize (DS_String* string, size_t size)
     assert (string);
     assert (string->buf);
 
-    /* Initialize variables */
-    int i;
-    int oldSize = (int) string->len;
-
-    /* Copy old buffer */
-    char* copy = calloc (oldSize, sizeof (char));
-    for (i = 0; i < oldSize; ++i)
-        copy [i] = string->buf [i];
+    /* Make room for the new size */
+    if (!DS_StrReserve (string, size))
+        return DS_STR_FAILURE;
 
-    /* Re-initialize the buffer */
-    free (string->buf);
-    string->buf = calloc (size, sizeof (char));
+    /* Clear the new bytes */
+    if (size > string->len)
+        memset (string->buf + string->len, 0, size - string->len);
 
-    /* Copy old buffer into start of new buffer */
-    if (string->buf) {
-        string->len = size;
-        for (i = 0; i < oldSize; ++i)
-            string->buf [i] = copy [i];
-
-        free (copy);
-        return DS_STR_SUCCESS;
-    }
-
-    /* Could not initialize the buffer, restore data */
-    string->buf = copy;
-    return DS_STR_FAILURE;
+    /* Update the length */
+    string->len = size;
+    return DS_STR_SUCCESS;
 }
 
 /**
@@ -173,14 +198,45 @@ int DS_StrAppend (DS_String* string, const uint8_t byte)
     assert (string);
     assert (string->buf);
 
-    /* Resize string and add extra character */
-    if (DS_StrResize (string, string->len + 1)) {
-        string->buf [string->len - 1] = byte;
+    /* Make room for the extra character */
+    if (!DS_StrReserve (string, string->len + 1))
+        return DS_STR_FAILURE;
+
+    /* Add the character */
+    string->buf [string->len] = (char) byte;
+    ++string->len;
+    return DS_STR_SUCCESS;
+}
+
+/**
+ * Appends \a len bytes from the given \a data to the end of the \a string
+ *
+ * \param string the original string
+ * \param data the bytes to append at the end of the string
+ * \param len the number of bytes to append
+ *
+ * \warning The program will quit if \a string is \c NULL
+ * \warning The program will quit if \a data is \c NULL and \a len is not 0
+ */
+int DS_StrAppendBytes (DS_String* string, const void* data, size_t len)
+{
+    /* Check arguments */
+    assert (string);
+    assert (string->buf);
+    assert (data || len == 0);
+
+    /* Nothing to append */
+    if (len == 0)
         return DS_STR_SUCCESS;
-    }
 
-    /* String cannot be resized */
-    return DS_STR_FAILURE;
+    /* Make room for the new data */
+    if (!DS_StrReserve (string, string->len + len))
+        return DS_STR_FAILURE;
+
+    /* Copy the data at the end of the string */
+    memcpy (string->buf + string->len, data, len);
+    string->len += len;
+    return DS_STR_SUCCESS;
 }
 
 /**
@@ -199,21 +255,8 @@ int DS_StrJoin (DS_String* first, const DS_String* second)
     assert (second->buf);
     assert (first->buf);
 
-    /* Get length of initial string */
-    int append_len = (int) second->len;
-    int original_len = (int) first->len;
-
-    /* Resize the string and append the other string */
-    if (DS_StrResize (first, original_len + append_len)) {
-        int i;
-        for (i = 0; i < append_len; ++i)
-            first->buf [original_len + i] = second->buf [i];
-
-        return DS_STR_SUCCESS;
-    }
-
-    /* String cannot be resized */
-    return DS_STR_FAILURE;
+    /* Append the other string */
+    return DS_StrAppendBytes (first, second->buf, second->len);
 }
 
 /**
@@ -227,15 +270,8 @@ int DS_StrJoinCStr (DS_String* string, const char* cstring)
     assert (string);
     assert (cstring);
 
-    /* Append each character to the string */
-    int i;
-    int len = (int) strlen (cstring);
-    for (i = 0; i < len; ++i)
-        if (!DS_StrAppend (string, cstring [i]))
-            return DS_STR_FAILURE;
-
-    /* Tell everyone how smart this function is */
-    return DS_STR_SUCCESS;
+    /* Append the characters to the string */
+    return DS_StrAppendBytes (string, cstring, strlen (cstring));
 }
 
 /**
@@ -280,9 +316,8 @@ char* DS_StrToChar (const DS_String* string)
     char* cstr = (char*) calloc (len, sizeof (char));
 
     /* Copy buffer data into c-string */
-    int i;
-    for (i = 0; i < (int) string->len; ++i)
-        cstr [i] = string->buf [i];
+    if (string->len > 0)
+        memcpy (cstr, string->buf, string->len);
 
     /* Add NULL-terminator */
     cstr [string->len] = 0;
@@ -334,9 +369,8 @@ DS_String DS_StrNew (const char* string)
     DS_String str = DS_StrNewLen (strlen (string));
 
     /* Copy C string data into buffer */
-    int i;
-    for (i = 0; i < (int) str.len; ++i)
-        str.buf [i] = string [i];
+    if (str.len > 0)
+        memcpy (str.buf, string, str.len);
 
     /* Return obtained string */
     return str;
@@ -349,7 +383,8 @@ DS_String DS_StrNewLen (const size_t length)
 {
     DS_String string;
     string.len = length;
-    string.buf = (char*) calloc (string.len, sizeof (char));
+    string.cap = length > 0 ? length : 1;
+    string.buf = (char*) calloc (string.cap, sizeof (char));
     return string;
 }
 
@@ -367,10 +402,9 @@ DS_String DS_StrDup (const DS_String* source)
     /* Create new empty string */
     DS_String string = DS_StrNewLen (source->len);
 
-    /* Copy each character to the new string */
-    int i;
-    for (i = 0; i < (int) string.len; ++i)
-        string.buf [i] = source->buf [i];
+    /* Copy the data to the new string */
+    if (string.len > 0)
+        memcpy (string.buf, source->buf, string.len);
 
     /* Return the copy */
     return string;
@@ -429,11 +463,8 @@ DS_String DS_StrFormat (const char* format, ...)
                 else if (next == 'f')
                     SPRINTF_S (str, sizeof (str), "%.2f", (double) va_arg (args, double));
 
-                /* Append every character to the string */
-                int i = 0;
-                int len = (int) strlen (str);
-                for (i = 0; i < len; ++i)
-                    DS_StrAppend (&string, str [i]);
+                /* Append the number to the string */
+                DS_StrAppendBytes (&string, str, strlen (str));
             }
 
             /* Handle characters */
@@ -443,12 +474,7 @@ DS_String DS_StrFormat (const char* format, ...)
             /* Handle strings */
             else if (next == 's') {
                 char* str = (char*) va_arg (args, char*);
-                int len = (int) strlen (str);
-
-                /* Append every character to the string */
-                int i = 0;
-                for (i = 0; i < len; ++i)
-                    DS_StrAppend (&string, str [i]);
+                DS_StrAppendBytes (&string, str, strlen (str));
             }
 
             /* Handle everything else */
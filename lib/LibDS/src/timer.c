@@ -22,72 +22,307 @@
  */
 
 #include "DS_Utils.h"
-#include "DS_Array.h"
 #include "DS_Timer.h"
 
+#include <time.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #if defined _WIN32
     #include <windows.h>
+    #include <sys/timeb.h>
 #else
     #include <unistd.h>
+    #include <sys/time.h>
 #endif
 
-static DS_Array timers;
+#if defined __APPLE__
+    #include <mach/mach_time.h>
+#endif
+
+/*
+ * All timers are kept in a binary min-heap ordered by their deadlines, a
+ * single scheduler thread sleeps until the earliest deadline is reached
+ * and marks the timer as expired
+ */
+static DS_Timer** heap = NULL;
+static int heap_size = 0;
+static int heap_capacity = 0;
+
 static int running = 0;
+static pthread_t scheduler;
+static pthread_cond_t wakeup;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Timer whose callback is running (without holding the mutex), stopping
+ * that timer waits on \c callback_done until the callback returns
+ */
+static DS_Timer* firing = NULL;
+static pthread_cond_t callback_done = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Returns the monotonic time (in microseconds) at which the given \a timer
+ * shall expire
+ */
+static uint64_t deadline (const DS_Timer* timer)
+{
+    return timer->start + (uint64_t) timer->time * 1000;
+}
+
+/**
+ * Swaps the heap items at positions \a a and \a b
+ */
+static void heap_swap (const int a, const int b)
+{
+    DS_Timer* temp = heap [a];
+
+    heap [a] = heap [b];
+    heap [b] = temp;
+    heap [a]->queue_pos = a;
+    heap [b]->queue_pos = b;
+}
+
+/**
+ * Moves the heap item at \a pos up until the heap order is restored
+ */
+static void sift_up (int pos)
+{
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (deadline (heap [parent]) <= deadline (heap [pos]))
+            break;
+
+        heap_swap (pos, parent);
+        pos = parent;
+    }
+}
+
+/**
+ * Moves the heap item at \a pos down until the heap order is restored
+ */
+static void sift_down (int pos)
+{
+    while (1) {
+        int left = pos * 2 + 1;
+        int right = left + 1;
+        int smallest = pos;
+
+        if (left < heap_size && deadline (heap [left]) < deadline (heap [smallest]))
+            smallest = left;
+        if (right < heap_size && deadline (heap [right]) < deadline (heap [smallest]))
+            smallest = right;
+
+        if (smallest == pos)
+            break;
+
+        heap_swap (pos, smallest);
+        pos = smallest;
+    }
+}
+
+/**
+ * Adds the given \a timer to the scheduler queue
+ */
+static void heap_insert (DS_Timer* timer)
+{
+    assert (timer);
+
+    /* Grow the queue if needed */
+    if (heap_size >= heap_capacity) {
+        heap_capacity = DS_Max (heap_capacity * 2, 8);
+        heap = (DS_Timer**) realloc (heap, sizeof (DS_Timer*) * heap_capacity);
+        assert (heap);
+    }
+
+    /* Append the timer and restore heap order */
+    heap [heap_size] = timer;
+    timer->queue_pos = heap_size;
+    ++heap_size;
+    sift_up (timer->queue_pos);
+}
+
+/**
+ * Removes the timer at the given \a pos from the scheduler queue
+ */
+static void heap_remove (const int pos)
+{
+    assert (pos >= 0 && pos < heap_size);
+
+    /* Detach the timer */
+    heap [pos]->queue_pos = -1;
+    --heap_size;
+
+    /* Move the last item into the empty slot */
+    if (pos < heap_size) {
+        heap [pos] = heap [heap_size];
+        heap [pos]->queue_pos = pos;
+        sift_down (pos);
+        sift_up (pos);
+    }
+}
+
+/**
+ * (Re)schedules the given \a timer, this function must be called with
+ * the module mutex locked
+ */
+static void schedule (DS_Timer* timer)
+{
+    assert (timer);
+
+    /* Remove the timer from the queue */
+    if (timer->queue_pos >= 0)
+        heap_remove (timer->queue_pos);
+
+    /* Queue the timer again (only if it can expire) */
+    if (timer->enabled && timer->time > 0 && !timer->expired)
+        heap_insert (timer);
+
+    /* Let the scheduler re-evaluate its next deadline */
+    if (running)
+        pthread_cond_signal (&wakeup);
+}
 
 /**
- * Updates the properties of the given \a timer
- * This function is called in a separate thread for each timer that we use.
- * This is **not** the best way to implement a timer, but its effective,
- * easy to understand and efficient. Also, this implementation does not need
- * to play with the kernel/OS to compare elapsed times periodically.
+ * Blocks the scheduler thread until the given monotonic \a time (in usecs)
+ * is reached or until the condition variable is signaled. Each platform
+ * measures the timeout using a different clock, so we convert it here.
  */
-static void* update_timer (void* ptr)
+static void wait_until (const uint64_t time)
 {
-    assert (ptr);
-    DS_Timer* timer = (DS_Timer*) ptr;
+    struct timespec ts;
+    uint64_t now = DS_GetTimestamp();
+    uint64_t remaining = time > now ? time - now : 0;
+
+#if defined __linux__
+    (void) remaining;
+    ts.tv_sec = time / 1000000;
+    ts.tv_nsec = (time % 1000000) * 1000;
+    pthread_cond_timedwait (&wakeup, &mutex, &ts);
+#elif defined __APPLE__
+    ts.tv_sec = remaining / 1000000;
+    ts.tv_nsec = (remaining % 1000000) * 1000;
+    pthread_cond_timedwait_relative_np (&wakeup, &mutex, &ts);
+#else
+    uint64_t abs_time;
 
-    while (running == 1) {
-        if (timer->enabled && timer->time > 0 && !timer->expired) {
-            timer->elapsed += timer->precision;
+#if defined _WIN32
+    struct _timeb tb;
+    _ftime (&tb);
+    abs_time = (uint64_t) tb.time * 1000000 + (uint64_t) tb.millitm * 1000;
+#else
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    abs_time = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+
+    abs_time += remaining;
+    ts.tv_sec = abs_time / 1000000;
+    ts.tv_nsec = (abs_time % 1000000) * 1000;
+    pthread_cond_timedwait (&wakeup, &mutex, &ts);
+#endif
+}
+
+/**
+ * Waits for the earliest deadline in the queue and marks the corresponding
+ * timer as expired. Timers that are started, stopped or reset while we
+ * are sleeping wake up this thread, so that the next deadline is always
+ * the correct one.
+ */
+static void* run_scheduler (void* ptr)
+{
+    (void) ptr;
 
-            if (timer->elapsed >= timer->time)
-                timer->expired = 1;
+    pthread_mutex_lock (&mutex);
+
+    while (running) {
+        /* Nothing to do, wait until a timer is started */
+        if (heap_size <= 0) {
+            pthread_cond_wait (&wakeup, &mutex);
+            continue;
+        }
+
+        /* Expire the first timer or wait for its deadline */
+        DS_Timer* timer = heap [0];
+        uint64_t now = DS_GetTimestamp();
+        if (deadline (timer) <= now) {
+            timer->expired = 1;
+            timer->elapsed = (int) ((now - timer->start) / 1000);
+            heap_remove (0);
+
+            /* Notify the owner of the timer (without holding the lock) */
+            if (timer->callback) {
+                void (*callback) (void) = timer->callback;
+                firing = timer;
+                pthread_mutex_unlock (&mutex);
+                callback();
+                pthread_mutex_lock (&mutex);
+                firing = NULL;
+                pthread_cond_broadcast (&callback_done);
+            }
         }
 
-        DS_Sleep (timer->precision);
+        else
+            wait_until (deadline (timer));
     }
 
+    pthread_mutex_unlock (&mutex);
+
     return NULL;
 }
 
 /**
- * Initializes the timer array, which is used to keep track of all the timers
- * used by the library. We need to do this so that we can terminate each timer
- * thread once the module is closed.
+ * Initializes the scheduler condition and starts the scheduler thread
  */
 void Timers_Init (void)
 {
+    /* Use the monotonic clock for timed waits (where supported) */
+    pthread_condattr_t attr;
+    pthread_condattr_init (&attr);
+#if defined __linux__
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init (&wakeup, &attr);
+    pthread_condattr_destroy (&attr);
+
+    /* Start the scheduler thread */
     running = 1;
-    DS_ArrayInit (&timers, 10);
+    int error = pthread_create (&scheduler, NULL, &run_scheduler, NULL);
+
+    /* Check if thread was started */
+    assert (!error);
 }
 
 /**
- * Breaks all the timer loops and stops every thread used by this module
+ * Stops the scheduler thread and removes every timer from the queue
  */
 void Timers_Close (void)
 {
+    /* Stop the scheduler thread */
+    pthread_mutex_lock (&mutex);
     running = 0;
-    DS_ArrayFree (&timers);
+    pthread_cond_broadcast (&wakeup);
+    pthread_mutex_unlock (&mutex);
+    pthread_join (scheduler, NULL);
+
+    /* Detach queued timers and free the queue */
+    pthread_mutex_lock (&mutex);
+    while (heap_size > 0)
+        heap_remove (heap_size - 1);
+
+    free (heap);
+    heap = NULL;
+    heap_capacity = 0;
+    pthread_mutex_unlock (&mutex);
+
+    /* Delete the condition variable */
+    pthread_cond_destroy (&wakeup);
 }
 
 /**
  * Pauses the execution state of the program/thread for the given
  * number of \a millisecs.
- *
- * We use this function to update each timer based on its precision
  */
 void DS_Sleep (const int millisecs)
 {
@@ -99,15 +334,54 @@ void DS_Sleep (const int millisecs)
 }
 
 /**
- * Resets and disables the given \a timer
+ * Returns the value of a monotonic clock (in microseconds), this value
+ * is not affected by changes of the system time, so it is safe to use it
+ * for measuring intervals
+ */
+uint64_t DS_GetTimestamp (void)
+{
+#if defined _WIN32
+    LARGE_INTEGER count;
+    static LARGE_INTEGER frequency = {{0}};
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency (&frequency);
+
+    QueryPerformanceCounter (&count);
+    return (uint64_t) ((count.QuadPart / frequency.QuadPart) * 1000000 +
+                       (count.QuadPart % frequency.QuadPart) * 1000000
+                       / frequency.QuadPart);
+#elif defined __APPLE__
+    static mach_timebase_info_data_t info = {0, 0};
+    if (info.denom == 0)
+        mach_timebase_info (&info);
+
+    return (mach_absolute_time() * info.numer / info.denom) / 1000;
+#else
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/**
+ * Resets and disables the given \a timer, if the callback of the timer is
+ * running, this function waits until it returns
  */
 void DS_TimerStop (DS_Timer* timer)
 {
     assert (timer);
 
+    pthread_mutex_lock (&mutex);
     timer->enabled = 0;
     timer->expired = 0;
     timer->elapsed = 0;
+    schedule (timer);
+
+    /* Wait for the callback of the timer to return (unless it stops itself) */
+    while (firing == timer && !pthread_equal (pthread_self(), scheduler))
+        pthread_cond_wait (&callback_done, &mutex);
+
+    pthread_mutex_unlock (&mutex);
 }
 
 /**
@@ -117,9 +391,13 @@ void DS_TimerStart (DS_Timer* timer)
 {
     assert (timer);
 
+    pthread_mutex_lock (&mutex);
     timer->enabled = 1;
     timer->expired = 0;
     timer->elapsed = 0;
+    timer->start = DS_GetTimestamp();
+    schedule (timer);
+    pthread_mutex_unlock (&mutex);
 }
 
 /**
@@ -129,20 +407,53 @@ void DS_TimerReset (DS_Timer* timer)
 {
     assert (timer);
 
+    pthread_mutex_lock (&mutex);
     timer->expired = 0;
     timer->elapsed = 0;
+    timer->start = DS_GetTimestamp();
+    schedule (timer);
+    pthread_mutex_unlock (&mutex);
 }
 
 /**
- * Initializes the given \a timer with the given \a time and \a precision.
- * The timers are updated using a threaded while loop (that sleeps the number
- * of milliseconds specified with \a precision). As stated before, this is
- * probably not the best timer implementation out there, but its simple and
- * it works perfectly for this library.
+ * Resets the expired state of the given \a timer and schedules its next
+ * expiration exactly one period after the previous deadline. Unlike
+ * \c DS_TimerReset(), this does not accumulate the delay between the
+ * expiration of the timer and the call to this function.
  *
- * A word of advice, using a higher \a precision (lower value in msecs) will
- * result in increased CPU usage, this thing does not have morals and will eat
- * the whole cake if you allow it.
+ * If the timer is late by more than one period, the next deadline is
+ * calculated from the current time (to avoid bursts of expirations).
+ */
+void DS_TimerAdvance (DS_Timer* timer)
+{
+    assert (timer);
+
+    pthread_mutex_lock (&mutex);
+    uint64_t now = DS_GetTimestamp();
+    timer->start = deadline (timer);
+    if (timer->start > now || deadline (timer) <= now)
+        timer->start = now;
+
+    timer->expired = 0;
+    timer->elapsed = 0;
+    schedule (timer);
+    pthread_mutex_unlock (&mutex);
+}
+
+/**
+ * Initializes the given \a timer with the given \a time.
+ *
+ * Timers do not have their own threads, instead, the scheduler thread keeps
+ * a queue of all active timers (sorted by their deadline) and sleeps until
+ * the next deadline is reached. Changes to the \a time of the timer will
+ * take effect the next time that the timer is started or reset.
+ *
+ * The \a precision value is kept for API compatibility, deadlines are
+ * calculated with a monotonic clock and are not rounded to any interval.
+ *
+ * If the \c callback field of the timer is set, the scheduler thread will
+ * call it every time that the timer expires, so that other threads can sleep
+ * until the timer expires instead of polling its \c expired field.
  */
 void DS_TimerInit (DS_Timer* timer, const int time, const int precision)
 {
@@ -154,18 +465,15 @@ void DS_TimerInit (DS_Timer* timer, const int time, const int precision)
         return;
 
     /* Configure the timer */
+    pthread_mutex_lock (&mutex);
+    timer->start = 0;
     timer->enabled = 0;
+    timer->callback = NULL;
     timer->expired = 0;
     timer->elapsed = 0;
     timer->time = time;
+    timer->queue_pos = -1;
     timer->initialized = 1;
     timer->precision = precision;
-
-    /* Configure the thread */
-    pthread_t thread;
-    int error = pthread_create (&thread, NULL,
-                                &update_timer, (void*) timer);
-
-    /* Check if thread was started */
-    assert (!error);
+    pthread_mutex_unlock (&mutex);
 }
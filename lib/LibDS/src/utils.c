@@ -35,20 +35,125 @@
     #endif
 #endif
 
+/*
+ * Use the SIMD instructions that are always available in the target CPU
+ */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+    #define USE_SSE2 1
+    #include <emmintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+    #define USE_NEON 1
+    #include <arm_neon.h>
+#endif
+
+/**
+ * Converts the given \a value to a signed byte in the -127 to 127 range,
+ * \a scale is the number that \a value must be multiplied with
+ */
+static uint8_t quantize (const float value, const float scale)
+{
+    float scaled = value * scale;
+
+    /* Value is not a number */
+    if (scaled != scaled)
+        return 0;
+
+    /* Ensure that the value is in range */
+    if (scaled > 127)
+        scaled = 127;
+    else if (scaled < -127)
+        scaled = -127;
+
+    return (uint8_t) (int8_t) scaled;
+}
+
 /**
  * Returns a single byte value that represents the ratio between the
  * given \a value and the maximum number specified.
+ *
+ * The ratio is encoded as a signed byte, where \c -max is \c -127 and
+ * \c max is \c 127, values out of range are clamped.
  */
 uint8_t DS_FloatToByte (const float value, const float max)
 {
-    if (value != 0 && max != 0 && value <= max) {
-        int percent = (int) (value / max) * (0xFF / 2);
-        return (uint8_t) (percent & 0xFF);
-    }
+    if (max != 0)
+        return quantize (value, 127 / max);
 
     return 0;
 }
 
+/**
+ * Converts \a count \a values to bytes with \c DS_FloatToByte() and writes
+ * them to the given \a bytes array. The values are processed with SSE2 or
+ * NEON instructions when they are available.
+ *
+ * This function is used by the protocols to encode the axes of all the
+ * joysticks at once.
+ */
+void DS_FloatsToBytes (const float* values, uint8_t* bytes,
+                       const int count, const float max)
+{
+    int i = 0;
+
+    /* Check arguments */
+    assert (values || count <= 0);
+    assert (bytes || count <= 0);
+
+    /* Maximum is not valid */
+    if (max == 0) {
+        if (count > 0)
+            memset (bytes, 0, count);
+
+        return;
+    }
+
+    float scale = 127 / max;
+
+#if defined USE_SSE2
+    /* Convert 16 values at a time */
+    const __m128 s = _mm_set1_ps (scale);
+    const __m128 hi = _mm_set1_ps (127);
+    const __m128 lo = _mm_set1_ps (-127);
+    for (; i + 16 <= count; i += 16) {
+        __m128i words [4];
+        int j;
+
+        /* Scale and clamp the values, NaNs are set to 0 */
+        for (j = 0; j < 4; ++j) {
+            __m128 v = _mm_mul_ps (_mm_loadu_ps (values + i + j * 4), s);
+            v = _mm_and_ps (v, _mm_cmpord_ps (v, v));
+            v = _mm_min_ps (_mm_max_ps (v, lo), hi);
+            words [j] = _mm_cvttps_epi32 (v);
+        }
+
+        /* Narrow the integers to bytes */
+        __m128i low = _mm_packs_epi32 (words [0], words [1]);
+        __m128i high = _mm_packs_epi32 (words [2], words [3]);
+        _mm_storeu_si128 ((__m128i*) (bytes + i), _mm_packs_epi16 (low, high));
+    }
+#elif defined USE_NEON
+    /* Convert 8 values at a time */
+    const float32x4_t hi = vdupq_n_f32 (127);
+    const float32x4_t lo = vdupq_n_f32 (-127);
+    for (; i + 8 <= count; i += 8) {
+        /* Scale and clamp the values, conversion sets NaNs to 0 */
+        float32x4_t a = vmulq_n_f32 (vld1q_f32 (values + i), scale);
+        float32x4_t b = vmulq_n_f32 (vld1q_f32 (values + i + 4), scale);
+        a = vminq_f32 (vmaxq_f32 (a, lo), hi);
+        b = vminq_f32 (vmaxq_f32 (b, lo), hi);
+
+        /* Narrow the integers to bytes */
+        int16x8_t words = vcombine_s16 (vmovn_s32 (vcvtq_s32_f32 (a)),
+                                        vmovn_s32 (vcvtq_s32_f32 (b)));
+        vst1_u8 (bytes + i, vreinterpret_u8_s8 (vmovn_s16 (words)));
+    }
+#endif
+
+    /* Convert the remaining values */
+    for (; i < count; ++i)
+        bytes [i] = quantize (values [i], scale);
+}
+
 /**
  * Returns a string in the format of NET.TE.AM.HOST, examples include
  *    - \c DS_GetStaticIP (10, 3794, 2) will return \c 10.37.94.2
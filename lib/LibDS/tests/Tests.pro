@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = LibDS_Tests
+
+CONFIG += console
+CONFIG -= qt
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/../include
+
+SOURCES += \
+    $$PWD/main.c
@@ -0,0 +1,102 @@
+/*
+ * The Driver Station Library (LibDS)
+ * Copyright (c) 2015-2017 Alex Spataru <alex_spataru@outlook>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Verifies that every CRC32 implementation returns the same checksums as
+ * the byte-at-a-time table implementation. The implementation file is
+ * included directly so that the tests can call each implementation.
+ *
+ * The program returns EXIT_SUCCESS if all the tests pass.
+ */
+
+#include "../src/crc32.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SIZE    2100 /* Largest tested buffer (2014 packets are 1024 bytes) */
+#define MAX_OFFSET  8    /* Test every alignment of the buffer */
+
+static int failures = 0;
+static uint8_t data [MAX_SIZE + MAX_OFFSET];
+
+/**
+ * Checks that the given implementation returns the same result as the
+ * table implementation for every size and alignment
+ */
+static void check (const char* name,
+                   uint32_t (*function) (uint32_t, const uint8_t*, size_t))
+{
+    size_t size;
+    size_t offset;
+
+    for (offset = 0; offset < MAX_OFFSET; ++offset) {
+        for (size = 0; size <= MAX_SIZE; ++size) {
+            const uint8_t* p = data + offset;
+            uint32_t expected = crc32_bytes (0xFFFFFFFFUL, p, size);
+            uint32_t obtained = function (0xFFFFFFFFUL, p, size);
+
+            if (expected != obtained) {
+                printf ("FAIL: %s (size %d, offset %d)\n", name, (int) size, (int) offset);
+                ++failures;
+                return;
+            }
+        }
+    }
+
+    printf ("PASS: %s\n", name);
+}
+
+int main (void)
+{
+    int i;
+
+    /* Fill the test data with pseudo-random bytes */
+    srand (3794);
+    for (i = 0; i < (int) sizeof (data); ++i)
+        data [i] = (uint8_t) rand();
+
+    /* Generate the tables and select the implementation */
+    CRC32_Init();
+
+    /* Check the standard check value */
+    if (DS_CRC32 ("123456789", 9) != 0xCBF43926UL) {
+        printf ("FAIL: check value\n");
+        ++failures;
+    }
+
+    /* Compare the implementations */
+    check ("slice-by-8", &crc32_slice_by_8);
+    check ("DS_CRC32", crc32_update);
+#if defined USE_PCLMUL
+    if (pclmul_supported())
+        check ("PCLMULQDQ", &crc32_pclmul);
+    else
+        printf ("SKIP: PCLMULQDQ (not supported by the CPU)\n");
+#elif defined USE_ARM_CRC32
+    check ("ARMv8 CRC32", &crc32_arm);
+#endif
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -79,44 +79,87 @@ int DriverStation::diskUsage() const
 
 /**
  * Returns the packet loss percentage between the FMS and the client
+ * during the last second
  */
 int DriverStation::fmsPacketLoss() const
 {
-    qreal sent = (qreal) DS_SentFMSPackets();
-    qreal recv = (qreal) DS_ReceivedFMSPackets();
-
-    if (sent > 0)
-        return (1 - (recv / sent)) * 100;
-
-    return 100;
+    return packetLoss (LinkFMS, LossLastSecond);
 }
 
 /**
  * Returns the packet loss percentage between the radio and the client
+ * during the last second
  */
 int DriverStation::radioPacketLoss() const
 {
-    qreal sent = (qreal) DS_SentRadioPackets();
-    qreal recv = (qreal) DS_ReceivedRadioPackets();
-
-    if (sent > 0)
-        return (1 - (recv / sent)) * 100;
-
-    return 100;
+    return packetLoss (LinkRadio, LossLastSecond);
 }
 
 /**
  * Returns the packet loss percentage between the robot and the client
+ * during the last second
  */
 int DriverStation::robotPacketLoss() const
 {
-    qreal sent = (qreal) DS_SentRobotPackets();
-    qreal recv = (qreal) DS_ReceivedRobotPackets();
+    return packetLoss (LinkRobot, LossLastSecond);
+}
+
+/**
+ * Returns the average round-trip time (in milliseconds) of the FMS packets
+ */
+qreal DriverStation::fmsLatency() const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (DS_LINK_FMS, &stats);
+    return stats.mean_rtt;
+}
+
+/**
+ * Returns the average round-trip time (in milliseconds) of the robot packets
+ */
+qreal DriverStation::robotLatency() const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (DS_LINK_ROBOT, &stats);
+    return stats.mean_rtt;
+}
+
+/**
+ * Returns the packet delay variation (in milliseconds) of the FMS link
+ */
+qreal DriverStation::fmsJitter() const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (DS_LINK_FMS, &stats);
+    return stats.jitter;
+}
+
+/**
+ * Returns the packet delay variation (in milliseconds) of the robot link
+ */
+qreal DriverStation::robotJitter() const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (DS_LINK_ROBOT, &stats);
+    return stats.jitter;
+}
 
-    if (sent > 0)
-        return (1 - (recv / sent)) * 100;
+/**
+ * Returns the average time (in milliseconds) between a joystick input and
+ * the moment in which it was sent to the robot
+ */
+qreal DriverStation::averageInputLatency() const
+{
+    return DS_GetAverageInputLatency();
+}
 
-    return 100;
+/**
+ * Returns the highest time (in milliseconds) between a joystick input and
+ * the moment in which it was sent to the robot
+ */
+qreal DriverStation::maxInputLatency() const
+{
+    return DS_GetMaxInputLatency();
 }
 
 /**
@@ -628,6 +671,109 @@ unsigned long DriverStation::receivedRobotBytes() const
     return DS_ReceivedRobotBytes();
 }
 
+/**
+ * Returns the number of packets received through the given \a link that
+ * were discarded because the LibDS did not read them in time
+ */
+int DriverStation::droppedPackets (const Link link) const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (static_cast<DS_Link> (link), &stats);
+    return stats.dropped;
+}
+
+/**
+ * Returns the number of packets that were received more than once
+ * through the given \a link
+ */
+int DriverStation::duplicatePackets (const Link link) const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (static_cast<DS_Link> (link), &stats);
+    return stats.duplicates;
+}
+
+/**
+ * Returns the number of packets that were received after a newer packet
+ * through the given \a link
+ */
+int DriverStation::outOfOrderPackets (const Link link) const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (static_cast<DS_Link> (link), &stats);
+    return stats.out_of_order;
+}
+
+/**
+ * Returns the non-empty buckets of the round-trip time histogram of the
+ * given \a link, each item contains the highest round-trip time stored by
+ * the bucket (\c limit, in milliseconds) and its sample \c count
+ */
+QVariantList DriverStation::latencyHistogram (const Link link) const
+{
+    QVariantList list;
+    unsigned long counts [DS_LATENCY_BUCKETS];
+    int buckets = DS_GetLatencyHistogram (static_cast<DS_Link> (link),
+                                          counts, DS_LATENCY_BUCKETS);
+
+    for (int i = 0; i < buckets; ++i) {
+        if (counts [i] > 0) {
+            QVariantMap bucket;
+            bucket.insert ("limit", DS_GetLatencyBucketLimit (i));
+            bucket.insert ("count", static_cast<qulonglong> (counts [i]));
+            list.append (bucket);
+        }
+    }
+
+    return list;
+}
+
+/**
+ * Returns the packet loss percentage of the given \a link during the
+ * given time \a window
+ */
+qreal DriverStation::packetLoss (const Link link,
+                                 const LossWindow window) const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (static_cast<DS_Link> (link), &stats);
+
+    switch (window) {
+    case LossLastSecond:
+        return stats.loss_1s;
+        break;
+    case LossLastTenSeconds:
+        return stats.loss_10s;
+        break;
+    case LossTotal:
+        return stats.loss_total;
+        break;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns the number of packets lost through the given \a link since
+ * the link statistics were reset
+ */
+int DriverStation::lostPackets (const Link link) const
+{
+    DS_LinkStats stats;
+    DS_GetLinkStats (static_cast<DS_Link> (link), &stats);
+    return stats.lost;
+}
+
+/**
+ * Returns the round-trip time (in milliseconds) below which the given
+ * \a percentile of the packets of the \a link were answered
+ */
+qreal DriverStation::latencyPercentile (const Link link,
+                                        const qreal percentile) const
+{
+    return DS_GetLatencyPercentile (static_cast<DS_Link> (link), percentile);
+}
+
 /**
  * Returns the number of axes that the given \a joystick has.
  * If the joystick does not exist, this function will return \c 0
@@ -689,6 +835,17 @@ void DriverStation::resetJoysticks()
     emit joystickCountChanged();
 }
 
+/**
+ * Clears the latency and packet loss statistics of every link, this can be
+ * used to measure the network conditions of each match separately
+ */
+void DriverStation::resetLinkStatistics()
+{
+    DS_ResetLinkStats (DS_LINK_FMS);
+    DS_ResetLinkStats (DS_LINK_RADIO);
+    DS_ResetLinkStats (DS_LINK_ROBOT);
+}
+
 /**
  * Restarts the robot code process in the robot controller
  */
@@ -29,6 +29,7 @@
 
 #include <QTime>
 #include <QObject>
+#include <QVariant>
 #include <QStringList>
 #include <DS_Protocol.h>
 
@@ -156,6 +157,18 @@ class DriverStation : public QObject
                 READ radioPacketLoss)
     Q_PROPERTY (int robotPacketLoss
                 READ robotPacketLoss)
+    Q_PROPERTY (qreal fmsLatency
+                READ fmsLatency)
+    Q_PROPERTY (qreal robotLatency
+                READ robotLatency)
+    Q_PROPERTY (qreal fmsJitter
+                READ fmsJitter)
+    Q_PROPERTY (qreal robotJitter
+                READ robotJitter)
+    Q_PROPERTY (qreal averageInputLatency
+                READ averageInputLatency)
+    Q_PROPERTY (qreal maxInputLatency
+                READ maxInputLatency)
     Q_PROPERTY (bool isTestMode
                 READ isTestMode
                 NOTIFY controlModeChanged)
@@ -208,6 +221,20 @@ public:
     };
     Q_ENUMS (Station)
 
+    enum Link {
+        LinkFMS = 0x00,
+        LinkRadio = 0x01,
+        LinkRobot = 0x02,
+    };
+    Q_ENUMS (Link)
+
+    enum LossWindow {
+        LossLastSecond = 0x00,
+        LossLastTenSeconds = 0x01,
+        LossTotal = 0x02,
+    };
+    Q_ENUMS (LossWindow)
+
     static void declareQML()
     {
 #ifdef QT_QML_LIB
@@ -231,6 +258,13 @@ public:
     int radioPacketLoss() const;
     int robotPacketLoss() const;
 
+    qreal fmsLatency() const;
+    qreal robotLatency() const;
+    qreal fmsJitter() const;
+    qreal robotJitter() const;
+    qreal averageInputLatency() const;
+    qreal maxInputLatency() const;
+
     bool isEnabled() const;
     bool isTestMode() const;
     bool canBeEnabled() const;
@@ -275,6 +309,16 @@ public:
     Q_INVOKABLE unsigned long receivedRadioBytes() const;
     Q_INVOKABLE unsigned long receivedRobotBytes() const;
 
+    Q_INVOKABLE int lostPackets (const Link link) const;
+    Q_INVOKABLE int droppedPackets (const Link link) const;
+    Q_INVOKABLE int duplicatePackets (const Link link) const;
+    Q_INVOKABLE int outOfOrderPackets (const Link link) const;
+    Q_INVOKABLE QVariantList latencyHistogram (const Link link) const;
+    Q_INVOKABLE qreal packetLoss (const Link link,
+                                  const LossWindow window) const;
+    Q_INVOKABLE qreal latencyPercentile (const Link link,
+                                         const qreal percentile) const;
+
     Q_INVOKABLE int getNumAxes (const int joystick) const;
     Q_INVOKABLE int getNumHats (const int joystick) const;
     Q_INVOKABLE int getNumButtons (const int joystick) const;
@@ -283,6 +327,7 @@ public slots:
     void start();
     void rebootRobot();
     void resetJoysticks();
+    void resetLinkStatistics();
     void restartRobotCode();
     void setEnabled (const bool enabled);
     void setTeamNumber (const int number);
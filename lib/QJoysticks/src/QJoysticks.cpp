@@ -21,6 +21,7 @@
  */
 
 #include <QDebug>
+#include <QTimer>
 #include <QSettings>
 #include <QJoysticks.h>
 #include <QJoysticks/SDL_Joysticks.h>
@@ -32,13 +33,13 @@ QJoysticks::QJoysticks()
     m_sdlJoysticks = new SDL_Joysticks (this);
     m_virtualJoystick = new VirtualJoystick (this);
 
-    /* Configure SDL joysticks */
+    /* Configure SDL joysticks (input events are emitted by the input thread) */
     connect (sdlJoysticks(),    &SDL_Joysticks::POVEvent,
-             this,              &QJoysticks::POVEvent);
+             this,              &QJoysticks::POVEvent, Qt::DirectConnection);
     connect (sdlJoysticks(),    &SDL_Joysticks::axisEvent,
-             this,              &QJoysticks::axisEvent);
+             this,              &QJoysticks::axisEvent, Qt::DirectConnection);
     connect (sdlJoysticks(),    &SDL_Joysticks::buttonEvent,
-             this,              &QJoysticks::buttonEvent);
+             this,              &QJoysticks::buttonEvent, Qt::DirectConnection);
     connect (sdlJoysticks(),    &SDL_Joysticks::countChanged,
              this,              &QJoysticks::updateInterfaces);
 
@@ -52,7 +53,7 @@ QJoysticks::QJoysticks()
     connect (virtualJoystick(), &VirtualJoystick::enabledChanged,
              this,              &QJoysticks::updateInterfaces);
 
-    /* React to own signals to create QML signals */
+    /* React to own signals to create QML signals (in the GUI thread) */
     connect (this, &QJoysticks::POVEvent,
              this, &QJoysticks::onPOVEvent);
     connect (this, &QJoysticks::axisEvent,
@@ -62,12 +63,19 @@ QJoysticks::QJoysticks()
 
     /* Configure the settings */
     m_sortJoyticks = 0;
+    m_blacklistChanged = false;
     m_settings = new QSettings (qApp->organizationName(), qApp->applicationName());
     m_settings->beginGroup ("Blacklisted Joysticks");
+
+    /* Load the blacklist once, it is only written back when changed */
+    foreach (const QString& name, m_settings->childKeys())
+        m_blacklist.insert (name, m_settings->value (name, false).toBool());
 }
 
 QJoysticks::~QJoysticks()
 {
+    saveBlacklist();
+
     delete m_settings;
     delete m_sdlJoysticks;
     delete m_virtualJoystick;
@@ -196,7 +204,7 @@ int QJoysticks::getNumButtons (const int index)
 bool QJoysticks::isBlacklisted (const int index)
 {
     if (joystickExists (index))
-        return inputDevices().at (index)->blacklisted;
+        return m_devices.at (index)->blacklisted;
 
     return true;
 }
@@ -207,7 +215,7 @@ bool QJoysticks::isBlacklisted (const int index)
  */
 bool QJoysticks::joystickExists (const int index)
 {
-    return (index >= 0) && (count() > index);
+    return (index >= 0) && (m_devices.count() > index);
 }
 
 /**
@@ -250,7 +258,7 @@ VirtualJoystick* QJoysticks::virtualJoystick() const
 QJoystickDevice* QJoysticks::getInputDevice (const int index)
 {
     if (joystickExists (index))
-        return inputDevices().at (index);
+        return m_devices.at (index);
 
     return Q_NULLPTR;
 }
@@ -302,9 +310,14 @@ void QJoysticks::setBlacklisted (const int index, bool blacklisted)
     /* See if blacklist value was actually changed */
     bool changed = m_devices.at (index)->blacklisted != blacklisted;
 
-    /* Save settings */
+    /* Update the cache, the settings are written a bit later */
     m_devices.at (index)->blacklisted = blacklisted;
-    m_settings->setValue (getName (index), blacklisted);
+    m_blacklist.insert (getName (index), blacklisted);
+
+    if (changed && !m_blacklistChanged) {
+        m_blacklistChanged = true;
+        QTimer::singleShot (1000, this, SLOT (saveBlacklist()));
+    }
 
     /* Re-scan joysticks if blacklist value has changed */
     if (changed)
@@ -312,66 +325,79 @@ void QJoysticks::setBlacklisted (const int index, bool blacklisted)
 }
 
 /**
- * 'Rescans' for new/removed joysticks and registers them again.
+ * Filters the axis values of the joystick at the given \a index:
+ *
+ *   - Axis values smaller than the \a deadband are reported as \c 0, the rest
+ *     of the range is scaled so that the values still go from \c 0 to \c 1
+ *   - A new axis value is only reported if it differs from the last reported
+ *     value by at least \a threshold (or if the axis is centered/at its end)
+ *   - Only the newest value of each axis is reported after each input poll
+ *
+ * The filter is remembered for every joystick with the same name, so it is
+ * applied again when the joystick is re-attached.
+ *
+ * \note The virtual joystick is not affected by this function
  */
-void QJoysticks::updateInterfaces()
+void QJoysticks::setAxisFilter (const int index, const qreal deadband,
+                                const qreal threshold)
 {
-    m_devices.clear();
-
-    /* Put blacklisted joysticks at the bottom of the list */
-    if (m_sortJoyticks) {
-        /* Register non-blacklisted SDL joysticks */
-        foreach (QJoystickDevice* joystick, sdlJoysticks()->joysticks()) {
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
-            if (!joystick->blacklisted)
-                addInputDevice (joystick);
-        }
+    if (joystickExists (index)) {
+        QJoystickAxisFilter filter;
+        filter.deadband = deadband;
+        filter.threshold = threshold;
 
-        /* Register the virtual joystick (if its not blacklisted) */
-        if (virtualJoystick()->joystickEnabled()) {
-            QJoystickDevice* joystick = virtualJoystick()->joystick();
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+        m_axisFilters.insert (getName (index), filter);
+        sdlJoysticks()->setAxisFilter (getInputDevice (index), &filter);
+    }
+}
 
-            if (!joystick->blacklisted) {
-                addInputDevice (joystick);
-                virtualJoystick()->setJoystickID (inputDevices().count() - 1);
-            }
-        }
+/**
+ * Removes the axis filter of the joystick at the given \a index, its axis
+ * values will be reported as soon as they are read
+ */
+void QJoysticks::removeAxisFilter (const int index)
+{
+    if (joystickExists (index)) {
+        m_axisFilters.remove (getName (index));
+        sdlJoysticks()->setAxisFilter (getInputDevice (index), Q_NULLPTR);
+    }
+}
 
-        /* Register blacklisted SDL joysticks */
-        foreach (QJoystickDevice* joystick, sdlJoysticks()->joysticks()) {
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
-            if (joystick->blacklisted)
-                addInputDevice (joystick);
-        }
+/**
+ * 'Rescans' for new/removed joysticks and registers them again.
+ */
+void QJoysticks::updateInterfaces()
+{
+    m_devices.clear();
 
-        /* Register the virtual joystick (if its blacklisted) */
-        if (virtualJoystick()->joystickEnabled()) {
-            QJoystickDevice* joystick = virtualJoystick()->joystick();
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+    /* Get the devices (the virtual joystick always goes last) */
+    QList<QJoystickDevice*> devices = sdlJoysticks()->joysticks();
 
-            if (joystick->blacklisted) {
-                addInputDevice (joystick);
-                virtualJoystick()->setJoystickID (inputDevices().count() - 1);
-            }
+    /* Apply the axis filters (which are only supported by SDL joysticks) */
+    foreach (QJoystickDevice* joystick, devices) {
+        if (m_axisFilters.contains (joystick->name)) {
+            QJoystickAxisFilter filter = m_axisFilters.value (joystick->name);
+            sdlJoysticks()->setAxisFilter (joystick, &filter);
         }
     }
 
-    /* Sort normally */
-    else {
-        /* Register SDL joysticks */
-        foreach (QJoystickDevice* joystick, sdlJoysticks()->joysticks()) {
-            addInputDevice (joystick);
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
-        }
+    if (virtualJoystick()->joystickEnabled())
+        devices.append (virtualJoystick()->joystick());
 
-        /* Register virtual joystick */
-        if (virtualJoystick()->joystickEnabled()) {
-            QJoystickDevice* joystick = virtualJoystick()->joystick();
-            joystick->blacklisted = m_settings->value (joystick->name, false).toBool();
+    /* Get the blacklist state of each device from the cache */
+    foreach (QJoystickDevice* joystick, devices)
+        joystick->blacklisted = m_blacklist.value (joystick->name, false);
 
+    /* Register the devices (blacklisted ones go last if sorting is enabled) */
+    foreach (QJoystickDevice* joystick, devices) {
+        if (!m_sortJoyticks || !joystick->blacklisted)
             addInputDevice (joystick);
-            virtualJoystick()->setJoystickID (inputDevices().count() - 1);
+    }
+
+    if (m_sortJoyticks) {
+        foreach (QJoystickDevice* joystick, devices) {
+            if (joystick->blacklisted)
+                addInputDevice (joystick);
         }
     }
 
@@ -397,6 +423,20 @@ void QJoysticks::setVirtualJoystickEnabled (bool enabled)
     virtualJoystick()->setJoystickEnabled (enabled);
 }
 
+/**
+ * Writes the blacklist changes to the settings
+ */
+void QJoysticks::saveBlacklist()
+{
+    if (m_blacklistChanged) {
+        QHash<QString, bool>::const_iterator i;
+        for (i = m_blacklist.constBegin(); i != m_blacklist.constEnd(); ++i)
+            m_settings->setValue (i.key(), i.value());
+
+        m_blacklistChanged = false;
+    }
+}
+
 /**
  * Removes all the registered joysticks and emits appropriate signals.
  */
@@ -407,23 +447,47 @@ void QJoysticks::resetJoysticks()
 }
 
 /**
- * Registers the given \a device to the \c QJoysticks system
+ * Registers the given \a device to the \c QJoysticks system, the ID of the
+ * device is set to the slot that it occupies in the device list
  */
 void QJoysticks::addInputDevice (QJoystickDevice* device)
 {
     Q_ASSERT (device);
+
+    if (device == virtualJoystick()->joystick())
+        virtualJoystick()->setJoystickID (m_devices.count());
+    else
+        sdlJoysticks()->setJoystickID (device, m_devices.count());
+
     m_devices.append (device);
 }
 
+/**
+ * Returns the given \a device if it is still registered in the slot given by
+ * its ID and it is not blacklisted, otherwise, the function returns \c NULL
+ */
+QJoystickDevice* QJoysticks::getRegisteredDevice (const QJoystickDevice* device)
+{
+    if (device && joystickExists (device->id)) {
+        QJoystickDevice* registered = m_devices.at (device->id);
+        if (registered == device && !registered->blacklisted)
+            return registered;
+    }
+
+    return Q_NULLPTR;
+}
+
 /**
  * Configures the QML-friendly signal based on the information given by the
  * \a event data and updates the joystick values
  */
 void QJoysticks::onPOVEvent (const QJoystickPOVEvent& e)
 {
-    if (!isBlacklisted (e.joystick->id)) {
-        getInputDevice (e.joystick->id)->povs [e.pov] = e.angle;
-        emit povChanged (e.joystick->id, e.pov, e.angle);
+    QJoystickDevice* device = getRegisteredDevice (e.joystick);
+
+    if (device && e.pov < device->povs.count()) {
+        device->povs [e.pov] = e.angle;
+        emit povChanged (device->id, e.pov, e.angle);
     }
 }
 
@@ -433,9 +497,11 @@ void QJoysticks::onPOVEvent (const QJoystickPOVEvent& e)
  */
 void QJoysticks::onAxisEvent (const QJoystickAxisEvent& e)
 {
-    if (!isBlacklisted (e.joystick->id)) {
-        getInputDevice (e.joystick->id)->axes [e.axis] = e.value;
-        emit axisChanged (e.joystick->id, e.axis, e.value);
+    QJoystickDevice* device = getRegisteredDevice (e.joystick);
+
+    if (device && e.axis < device->axes.count()) {
+        device->axes [e.axis] = e.value;
+        emit axisChanged (device->id, e.axis, e.value);
     }
 }
 
@@ -445,8 +511,10 @@ void QJoysticks::onAxisEvent (const QJoystickAxisEvent& e)
  */
 void QJoysticks::onButtonEvent (const QJoystickButtonEvent& e)
 {
-    if (!isBlacklisted (e.joystick->id)) {
-        getInputDevice (e.joystick->id)->buttons [e.button] = e.pressed;
-        emit buttonChanged (e.joystick->id, e.button, e.pressed);
+    QJoystickDevice* device = getRegisteredDevice (e.joystick);
+
+    if (device && e.button < device->buttons.count()) {
+        device->buttons [e.button] = e.pressed;
+        emit buttonChanged (device->id, e.button, e.pressed);
     }
 }
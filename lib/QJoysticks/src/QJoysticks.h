@@ -23,6 +23,7 @@
 #ifndef _QJOYSTICKS_MAIN_H
 #define _QJOYSTICKS_MAIN_H
 
+#include <QHash>
 #include <QObject>
 #include <QStringList>
 #include <QJoysticks/JoysticksCommon.h>
@@ -45,8 +46,21 @@ class VirtualJoystick;
  * has been connected to the computer will have \c 0 as an ID, the second
  * joystick will have \c 1 as an ID, and so on...
  *
+ * The ID of each device is its slot in the device list, so input events are
+ * dispatched by indexing the list. Events that were queued before the list
+ * was refreshed (e.g. from a removed joystick) are discarded.
+ *
+ * An axis filter (deadband and minimum change) can be set for each joystick
+ * with \c setAxisFilter(), which also reduces the axis events of the joystick
+ * to one per axis for each time that the input is polled.
+ *
  * \note the virtual joystick will ALWAYS be the last joystick to be registered,
  *       even if it has been enabled before any SDL joystick has been attached.
+ *
+ * \note The \c POVEvent, \c axisEvent and \c buttonEvent signals may be
+ *       emitted from the SDL input thread, use a direct connection to react
+ *       to them as soon as possible. The \c povChanged, \c axisChanged and
+ *       \c buttonChanged signals are always emitted from the GUI thread.
  */
 class QJoysticks : public QObject
 {
@@ -102,12 +116,16 @@ public slots:
     void setVirtualJoystickEnabled (bool enabled);
     void setSortJoysticksByBlacklistState (bool sort);
     void setBlacklisted (int index, bool blacklisted);
+    void removeAxisFilter (const int index);
+    void setAxisFilter (const int index, const qreal deadband,
+                        const qreal threshold);
 
 protected:
     explicit QJoysticks();
     ~QJoysticks();
 
 private slots:
+    void saveBlacklist();
     void resetJoysticks();
     void addInputDevice (QJoystickDevice* device);
     void onPOVEvent (const QJoystickPOVEvent& e);
@@ -115,7 +133,12 @@ private slots:
     void onButtonEvent (const QJoystickButtonEvent& e);
 
 private:
+    QJoystickDevice* getRegisteredDevice (const QJoystickDevice* device);
+
     bool m_sortJoyticks;
+    bool m_blacklistChanged;
+    QHash<QString, bool> m_blacklist;
+    QHash<QString, QJoystickAxisFilter> m_axisFilters;
 
     QSettings* m_settings;
     SDL_Joysticks* m_sdlJoysticks;
@@ -24,6 +24,7 @@
 #define _QJOYSTICKS_COMMON_H
 
 #include <QString>
+#include <QMetaType>
 
 /**
  * @brief Represents a joystick and its properties
@@ -45,6 +46,18 @@ struct QJoystickDevice {
     bool    blacklisted; /**< Holds \c true if the joystick is disabled */
 };
 
+/**
+ * @brief Represents the filter applied to the axes of a joystick
+ *
+ * This structure contains:
+ *    - The deadband, axis values smaller than it are reported as \c 0
+ *    - The minimum change that an axis must have before being reported
+ */
+struct QJoystickAxisFilter {
+    qreal deadband;  /**< The deadband (from 0 to 1) of each axis */
+    qreal threshold; /**< The minimum change needed to report a new value */
+};
+
 /**
  * @brief Represents a joystick rumble request
  *
@@ -101,4 +114,8 @@ struct QJoystickButtonEvent {
     QJoystickDevice* joystick; /**< Pointer to the device that caused the event */
 };
 
+Q_DECLARE_METATYPE (QJoystickPOVEvent)
+Q_DECLARE_METATYPE (QJoystickAxisEvent)
+Q_DECLARE_METATYPE (QJoystickButtonEvent)
+
 #endif
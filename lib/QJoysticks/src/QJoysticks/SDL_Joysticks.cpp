@@ -22,7 +22,7 @@
 
 #include <QFile>
 #include <QDebug>
-#include <QTimer>
+#include <QThread>
 #include <QApplication>
 #include <QJoysticks/SDL_Joysticks.h>
 
@@ -47,56 +47,101 @@ static QString GENERIC_MAPPINGS;
     #endif
 #endif
 
-SDL_Joysticks::SDL_Joysticks (QObject* parent) : QObject (parent)
+/**
+ * Default time (in milliseconds) between each poll of the SDL event queue
+ */
+const int DEFAULT_POLLING_INTERVAL = 2;
+
+/**
+ * \brief Runs the SDL event loop outside of the GUI thread
+ */
+class SDL_InputThread : public QThread
 {
-    m_tracker = -1;
+public:
+    SDL_InputThread (SDL_Joysticks* joysticks) : m_joysticks (joysticks) {}
 
-#ifdef SDL_SUPPORTED
-    if (SDL_Init (SDL_INIT_HAPTIC | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER)) {
-        qDebug() << "Cannot initialize SDL:" << SDL_GetError();
-        qApp->quit();
+protected:
+    void run()
+    {
+        m_joysticks->processEvents();
     }
 
-    QFile database (":/QJoysticks/SDL/Database.txt");
-    if (database.open (QFile::ReadOnly)) {
-        while (!database.atEnd()) {
-            QString line = QString::fromUtf8 (database.readLine());
-            SDL_GameControllerAddMapping (line.toStdString().c_str());
-        }
+private:
+    SDL_Joysticks* m_joysticks;
+};
 
-        database.close();
-    }
+SDL_Joysticks::SDL_Joysticks (QObject* parent) : QObject (parent)
+{
+    m_thread = Q_NULLPTR;
+    m_interval = DEFAULT_POLLING_INTERVAL;
 
-    QFile genericMappings (GENERIC_MAPPINGS_PATH);
-    if (genericMappings.open (QFile::ReadOnly)) {
-        GENERIC_MAPPINGS = QString::fromUtf8 (genericMappings.readAll());
-        genericMappings.close();
-    }
+    /* Allow the events to be queued to other threads */
+    qRegisterMetaType<QJoystickPOVEvent> ("QJoystickPOVEvent");
+    qRegisterMetaType<QJoystickAxisEvent> ("QJoystickAxisEvent");
+    qRegisterMetaType<QJoystickButtonEvent> ("QJoystickButtonEvent");
 
-    QTimer::singleShot (100, Qt::PreciseTimer, this, SLOT (update()));
+#ifdef SDL_SUPPORTED
+    /* Start the input thread and wait until SDL is initialized */
+    m_running = 1;
+    m_thread = new SDL_InputThread (this);
+    m_thread->start (QThread::TimeCriticalPriority);
+    m_ready.acquire();
 #endif
 }
 
 SDL_Joysticks::~SDL_Joysticks()
 {
 #ifdef SDL_SUPPORTED
+    m_running = 0;
+    m_thread->wait();
+    delete m_thread;
+
+    /* Close the devices that are still attached */
+    foreach (const SDL_Device& handle, m_handles) {
+        if (handle.controller)
+            SDL_GameControllerClose (handle.controller);
+        else
+            SDL_JoystickClose (handle.joystick);
+    }
+
     SDL_Quit();
 #endif
+
+    qDeleteAll (m_devices);
+    qDeleteAll (m_removed);
 }
 
 /**
- * Returns a list with all the registered joystick devices
+ * Returns the time (in milliseconds) between each poll of the SDL events
  */
-QList<QJoystickDevice*> SDL_Joysticks::joysticks()
+int SDL_Joysticks::pollingInterval() const
 {
-    QList<QJoystickDevice*> list;
+    return m_interval;
+}
 
-#ifdef SDL_SUPPORTED
-    for (int i = 0; i < SDL_NumJoysticks(); ++i)
-        list.append (getJoystick (i));
-#endif
+/**
+ * Returns a list with all the registered joystick devices, sorted in the
+ * order in which they were attached.
+ *
+ * The devices are owned by this class, no device is opened or allocated
+ * during the enumeration.
+ */
+QList<QJoystickDevice*> SDL_Joysticks::joysticks()
+{
+    QMutexLocker locker (&m_mutex);
+    return m_devices;
+}
 
-    return list;
+/**
+ * Changes the \a id (the \c QJoysticks slot) of the given \a joystick.
+ *
+ * The ID is changed while holding the mutex, since it is also read by the
+ * receivers of the input events in the input thread.
+ */
+void SDL_Joysticks::setJoystickID (QJoystickDevice* joystick, const int id)
+{
+    QMutexLocker locker (&m_mutex);
+    joystick->id = id;
 }
 
 /**
@@ -106,8 +151,14 @@ QList<QJoystickDevice*> SDL_Joysticks::joysticks()
 void SDL_Joysticks::rumble (const QJoystickRumble& request)
 {
 #ifdef SDL_SUPPORTED
-    SDL_Haptic* haptic = SDL_HapticOpen (request.joystick->id);
+    QMutexLocker locker (&m_mutex);
 
+    /* The joystick ID is the QJoysticks slot, get the SDL handle instead */
+    SDL_JoystickID id = m_registry.key (request.joystick, -1);
+    if (!m_handles.contains (id))
+        return;
+
+    SDL_Haptic* haptic = SDL_HapticOpenFromJoystick (m_handles [id].joystick);
     if (haptic) {
         SDL_HapticRumbleInit (haptic);
         SDL_HapticRumblePlay (haptic, request.strength, request.length);
@@ -118,39 +169,139 @@ void SDL_Joysticks::rumble (const QJoystickRumble& request)
 }
 
 /**
- * Polls for new SDL events and reacts to each event accordingly.
+ * Changes the time (in milliseconds) between each poll of the SDL events.
+ *
+ * Every event is handled as soon as it is read, so a short interval ensures
+ * that the robot packets always contain the newest joystick values.
  */
-void SDL_Joysticks::update()
+void SDL_Joysticks::setPollingInterval (const int msecs)
+{
+    m_interval = qMax (msecs, 1);
+}
+
+/**
+ * Filters the axis events of the given \a joystick with the given \a filter,
+ * if \a filter is \c NULL, every axis event is reported as soon as it is
+ * read (which is the default behavior).
+ *
+ * \note This function has no effect on joysticks not managed by this class
+ */
+void SDL_Joysticks::setAxisFilter (QJoystickDevice* joystick,
+                                   const QJoystickAxisFilter* filter)
+{
+    QMutexLocker locker (&m_mutex);
+    SDL_JoystickID id = m_registry.key (joystick, -1);
+
+    if (m_handles.contains (id)) {
+        SDL_Device& handle = m_handles [id];
+        handle.filtered = (filter != Q_NULLPTR);
+        handle.changed.fill (false);
+
+        if (filter) {
+            handle.filter.deadband = qBound (0.0, filter->deadband, 0.99);
+            handle.filter.threshold = qMax (0.0, filter->threshold);
+        }
+    }
+}
+
+/**
+ * Deletes the devices that have been removed since the last call.
+ *
+ * This function is queued to the GUI thread by \c removeJoystick(), so that
+ * every input event that referenced the removed devices (and the call to
+ * \c QJoysticks::updateInterfaces()) has been delivered before the devices
+ * are deleted.
+ */
+void SDL_Joysticks::releaseDevices()
+{
+    QMutexLocker locker (&m_mutex);
+    qDeleteAll (m_removed);
+    m_removed.clear();
+}
+
+/**
+ * Initializes SDL and polls for new SDL events until the object is destroyed,
+ * this function is executed by the input thread.
+ *
+ * Every SDL call is made while holding the mutex, since the SDL joystick API
+ * is not thread-safe (and \c joysticks() is called from the GUI thread).
+ */
+void SDL_Joysticks::processEvents()
 {
 #ifdef SDL_SUPPORTED
-    SDL_Event event;
+    m_mutex.lock();
 
-    while (SDL_PollEvent (&event)) {
-        switch (event.type) {
-        case SDL_JOYDEVICEADDED:
-            configureJoystick (&event);
-            break;
-        case SDL_JOYDEVICEREMOVED:
-            SDL_JoystickClose (SDL_JoystickOpen (event.jdevice.which));
-            SDL_GameControllerClose (SDL_GameControllerOpen (event.cdevice.which));
-            emit countChanged();
-            break;
-        case SDL_CONTROLLERAXISMOTION:
-            emit axisEvent (getAxisEvent (&event));
-            break;
-        case SDL_JOYBUTTONUP:
-            emit buttonEvent (getButtonEvent (&event));
-            break;
-        case SDL_JOYBUTTONDOWN:
-            emit buttonEvent (getButtonEvent (&event));
-            break;
-        case SDL_JOYHATMOTION:
-            emit POVEvent (getPOVEvent (&event));
-            break;
+    if (SDL_Init (SDL_INIT_HAPTIC | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER)) {
+        qDebug() << "Cannot initialize SDL:" << SDL_GetError();
+        QMetaObject::invokeMethod (qApp, "quit", Qt::QueuedConnection);
+    }
+
+    QFile database (":/QJoysticks/SDL/Database.txt");
+    if (database.open (QFile::ReadOnly)) {
+        while (!database.atEnd()) {
+            QString line = QString::fromUtf8 (database.readLine());
+            SDL_GameControllerAddMapping (line.toStdString().c_str());
         }
+
+        database.close();
+    }
+
+    QFile genericMappings (GENERIC_MAPPINGS_PATH);
+    if (genericMappings.open (QFile::ReadOnly)) {
+        GENERIC_MAPPINGS = QString::fromUtf8 (genericMappings.readAll());
+        genericMappings.close();
     }
 
-    QTimer::singleShot (10, Qt::PreciseTimer, this, SLOT (update()));
+    m_mutex.unlock();
+    m_ready.release();
+
+    /* Read the events until the object is destroyed */
+    SDL_Event event;
+    while (m_running) {
+        m_mutex.lock();
+        while (SDL_PollEvent (&event))
+            handleEvent (&event);
+
+        flushAxisEvents();
+        m_mutex.unlock();
+
+        QThread::msleep (m_interval);
+    }
+#endif
+}
+
+/**
+ * Reacts to the given SDL \a event accordingly.
+ */
+void SDL_Joysticks::handleEvent (const SDL_Event* event)
+{
+#ifdef SDL_SUPPORTED
+    switch (event->type) {
+    case SDL_JOYDEVICEADDED:
+        configureJoystick (event);
+        break;
+    case SDL_JOYDEVICEREMOVED:
+        removeJoystick (event);
+        break;
+    case SDL_CONTROLLERAXISMOTION:
+        if (getJoystick (event->caxis.which))
+            filterAxisEvent (event);
+        break;
+    case SDL_JOYBUTTONUP:
+        if (getJoystick (event->jbutton.which))
+            emit buttonEvent (getButtonEvent (event));
+        break;
+    case SDL_JOYBUTTONDOWN:
+        if (getJoystick (event->jbutton.which))
+            emit buttonEvent (getButtonEvent (event));
+        break;
+    case SDL_JOYHATMOTION:
+        if (getJoystick (event->jhat.which))
+            emit POVEvent (getPOVEvent (event));
+        break;
+    }
+#else
+    Q_UNUSED (event);
 #endif
 }
 
@@ -158,6 +309,9 @@ void SDL_Joysticks::update()
  * Checks if the joystick referenced by the \a event can be initialized.
  * If not, the function will apply a generic mapping to the joystick and
  * attempt to initialize the joystick again.
+ *
+ * Once the joystick is opened, a new device is added to the registry, the
+ * device (and its SDL handles) is kept until the joystick is removed.
  */
 void SDL_Joysticks::configureJoystick (const SDL_Event* event)
 {
@@ -179,9 +333,64 @@ void SDL_Joysticks::configureJoystick (const SDL_Event* event)
         }
     }
 
-    SDL_GameControllerOpen (event->cdevice.which);
+    /* Open the joystick (as a game controller if possible) */
+    SDL_Device handle;
+    handle.controller = SDL_GameControllerOpen (event->cdevice.which);
+
+    if (handle.controller)
+        handle.joystick = SDL_GameControllerGetJoystick (handle.controller);
+    else
+        handle.joystick = SDL_JoystickOpen (event->jdevice.which);
+
+    if (!handle.joystick) {
+        qWarning() << Q_FUNC_INFO << "Cannot open joystick:" << SDL_GetError();
+        return;
+    }
+
+    /* The joystick is already registered */
+    SDL_JoystickID id = SDL_JoystickInstanceID (handle.joystick);
+    if (m_registry.contains (id)) {
+        if (handle.controller)
+            SDL_GameControllerClose (handle.controller);
+        else
+            SDL_JoystickClose (handle.joystick);
+
+        return;
+    }
+
+    /* Create the device */
+    QJoystickDevice* joystick = new QJoystickDevice;
+    joystick->id = -1;
+    joystick->blacklisted = false;
+    joystick->name = SDL_JoystickName (handle.joystick);
+
+    /* Get joystick properties */
+    int povs = SDL_JoystickNumHats (handle.joystick);
+    int axes = SDL_JoystickNumAxes (handle.joystick);
+    int buttons = SDL_JoystickNumButtons (handle.joystick);
+
+    /* Initialize POVs */
+    for (int i = 0; i < povs; ++i)
+        joystick->povs.append (0);
+
+    /* Initialize axes */
+    for (int i = 0; i < axes; ++i)
+        joystick->axes.append (0);
+
+    /* Initialize buttons */
+    for (int i = 0; i < buttons; ++i)
+        joystick->buttons.append (false);
+
+    /* Axis events are not filtered by default */
+    handle.filtered = false;
+    handle.filter.deadband = 0;
+    handle.filter.threshold = 0;
+
+    /* Register the device */
+    m_devices.append (joystick);
+    m_handles.insert (id, handle);
+    m_registry.insert (id, joystick);
 
-    ++m_tracker;
     emit countChanged();
 #else
     Q_UNUSED (event);
@@ -189,69 +398,131 @@ void SDL_Joysticks::configureJoystick (const SDL_Event* event)
 }
 
 /**
- * Returns a joystick ID compatible with the \c QJoysticks system.
- * SDL assigns an ID to each joystick based on the order that they are attached,
- * but it does not decrease the ID counter when a joystick is removed.
- *
- * As noted earlier, the \c QJoysticks maintains an ID system similar to the
- * one used by a \c QList, since it eases the operation with most Qt classes
- * and widgets.
+ * Closes the joystick referenced by the \a event and removes it from the
+ * registry. The device itself is deleted later by \c releaseDevices().
  */
-int SDL_Joysticks::getDynamicID (int id)
+void SDL_Joysticks::removeJoystick (const SDL_Event* event)
 {
 #ifdef SDL_SUPPORTED
-    id = abs (m_tracker - (id + 1));
+    SDL_JoystickID id = event->jdevice.which;
+    QJoystickDevice* joystick = getJoystick (id);
 
-    if (id >= SDL_NumJoysticks())
-        id -= 1;
+    if (!joystick)
+        return;
 
-#endif
+    /* Close the SDL handles */
+    SDL_Device handle = m_handles.value (id);
+    if (handle.controller)
+        SDL_GameControllerClose (handle.controller);
+    else
+        SDL_JoystickClose (handle.joystick);
 
-    return id;
+    /* Unregister the device */
+    m_handles.remove (id);
+    m_registry.remove (id);
+    m_devices.removeAll (joystick);
+    m_removed.append (joystick);
+
+    emit countChanged();
+    QMetaObject::invokeMethod (this, "releaseDevices", Qt::QueuedConnection);
+#else
+    Q_UNUSED (event);
+#endif
 }
 
 /**
- * Returns the josytick device registered with the given \a id.
- * If no joystick with the given \a id is found, then the function will warn
- * the user through the console.
+ * Reports the axis \a event immediately if the joystick is not filtered,
+ * otherwise, the axis value is kept until the current poll is finished, so
+ * that only the newest value of each axis is reported by \c flushAxisEvents()
  */
-QJoystickDevice* SDL_Joysticks::getJoystick (int id)
+void SDL_Joysticks::filterAxisEvent (const SDL_Event* event)
 {
 #ifdef SDL_SUPPORTED
-    QJoystickDevice* joystick = new QJoystickDevice;
-    SDL_Joystick* sdl_joystick = SDL_JoystickOpen (id);
-    joystick->id = getDynamicID (id);
+    SDL_Device& handle = m_handles [event->caxis.which];
 
-    if (sdl_joystick) {
-        joystick->blacklisted = false;
-        joystick->name = SDL_JoystickName (sdl_joystick);
+    if (!handle.filtered) {
+        emit axisEvent (getAxisEvent (event));
+        return;
+    }
 
-        /* Get joystick properties */
-        int povs = SDL_JoystickNumHats (sdl_joystick);
-        int axes = SDL_JoystickNumAxes (sdl_joystick);
-        int buttons = SDL_JoystickNumButtons (sdl_joystick);
+    /* Resize the axis lists if needed */
+    int axis = event->caxis.axis;
+    if (axis >= handle.pending.count()) {
+        handle.changed.resize (axis + 1);
+        handle.values.resize (axis + 1);
+        handle.pending.resize (axis + 1);
+    }
 
-        /* Initialize POVs */
-        for (int i = 0; i < povs; ++i)
-            joystick->povs.append (0);
+    /* Keep the newest value */
+    handle.changed [axis] = true;
+    handle.pending [axis] = static_cast<qreal> (event->caxis.value) / 32767;
 
-        /* Initialize axes */
-        for (int i = 0; i < axes; ++i)
-            joystick->axes.append (0);
+    if (!m_filtered.contains (event->caxis.which))
+        m_filtered.append (event->caxis.which);
+#else
+    Q_UNUSED (event);
+#endif
+}
 
-        /* Initialize buttons */
-        for (int i = 0; i < buttons; ++i)
-            joystick->buttons.append (false);
+/**
+ * Applies the deadband to the axis values received during the last poll and
+ * reports the values that changed more than the threshold of the filter.
+ *
+ * The values that reach the center or the ends of the axis are always
+ * reported, so that the last reported value is never left slightly off.
+ */
+void SDL_Joysticks::flushAxisEvents()
+{
+    foreach (SDL_JoystickID id, m_filtered) {
+        if (!m_handles.contains (id))
+            continue;
+
+        SDL_Device& handle = m_handles [id];
+        for (int axis = 0; axis < handle.changed.count(); ++axis) {
+            if (!handle.changed.at (axis))
+                continue;
+
+            handle.changed [axis] = false;
+
+            /* Apply the deadband and scale the rest of the range */
+            qreal value = qBound (-1.0, handle.pending.at (axis), 1.0);
+            qreal deadband = handle.filter.deadband;
+            if (qAbs (value) <= deadband)
+                value = 0;
+            else if (value > 0)
+                value = (value - deadband) / (1 - deadband);
+            else
+                value = (value + deadband) / (1 - deadband);
+
+            /* Check if the change is big enough */
+            qreal last = handle.values.at (axis);
+            bool settled = (value == 0) || (qAbs (value) == 1);
+            if (value == last)
+                continue;
+            if (qAbs (value - last) < handle.filter.threshold && !settled)
+                continue;
+
+            /* Report the new value */
+            QJoystickAxisEvent event;
+            event.axis = axis;
+            event.value = value;
+            event.joystick = getJoystick (id);
+
+            handle.values [axis] = value;
+            emit axisEvent (event);
+        }
     }
 
-    else
-        qWarning() << Q_FUNC_INFO << "Cannot find joystick with id:" << id;
+    m_filtered.clear();
+}
 
-    return joystick;
-#else
-    Q_UNUSED (id);
-    return NULL;
-#endif
+/**
+ * Returns the joystick device registered with the given SDL instance \a id,
+ * or \c NULL if no joystick with the given \a id is attached.
+ */
+QJoystickDevice* SDL_Joysticks::getJoystick (SDL_JoystickID id)
+{
+    return m_registry.value (id, Q_NULLPTR);
 }
 
 /**
@@ -264,7 +535,7 @@ QJoystickPOVEvent SDL_Joysticks::getPOVEvent (const SDL_Event* sdl_event)
 
 #ifdef SDL_SUPPORTED
     event.pov = sdl_event->jhat.hat;
-    event.joystick = getJoystick (sdl_event->jdevice.which);
+    event.joystick = getJoystick (sdl_event->jhat.which);
 
     switch (sdl_event->jhat.value) {
     case SDL_HAT_RIGHTUP:
@@ -313,7 +584,7 @@ QJoystickAxisEvent SDL_Joysticks::getAxisEvent (const SDL_Event* sdl_event)
 #ifdef SDL_SUPPORTED
     event.axis = sdl_event->caxis.axis;
     event.value = static_cast<qreal> (sdl_event->caxis.value) / 32767;
-    event.joystick = getJoystick (sdl_event->cdevice.which);
+    event.joystick = getJoystick (sdl_event->caxis.which);
 #else
     Q_UNUSED (sdl_event);
 #endif
@@ -333,7 +604,7 @@ QJoystickButtonEvent SDL_Joysticks::getButtonEvent (const SDL_Event*
 #ifdef SDL_SUPPORTED
     event.button = sdl_event->jbutton.button;
     event.pressed = sdl_event->jbutton.state == SDL_PRESSED;
-    event.joystick = getJoystick (sdl_event->jdevice.which);
+    event.joystick = getJoystick (sdl_event->jbutton.which);
 #else
     Q_UNUSED (sdl_event);
 #endif
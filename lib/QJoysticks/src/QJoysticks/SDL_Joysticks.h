@@ -24,9 +24,16 @@
 #define _QJOYSTICKS_SDL_JOYSTICK_H
 
 #include <SDL.h>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QSemaphore>
 #include <QJoysticks/JoysticksCommon.h>
 
+class SDL_InputThread;
+
 /**
  * \brief Translates SDL events into \c QJoysticks events
  *
@@ -36,8 +43,18 @@
  * The only thing that differs from each operating system is the backup mapping
  * applied in the case that we do not know what mapping to apply to a joystick.
  *
- * \note The joystick values are refreshed every 20 milliseconds through a
- *       simple event loop.
+ * \note The joystick values are read by a dedicated input thread, which
+ *       polls SDL every few milliseconds (see \c setPollingInterval()).
+ *       The input signals are emitted from that thread, so receivers that
+ *       need the lowest latency should use direct connections.
+ *
+ * \note The joystick devices are created when SDL reports that they were
+ *       attached and are kept until they are removed, so the pointers
+ *       returned by \c joysticks() stay valid between enumerations.
+ *
+ * \note If an axis filter is set for a joystick, only the last value of
+ *       each axis is reported after each poll, and only if the (deadbanded)
+ *       value changed enough since the last report.
  */
 class SDL_Joysticks : public QObject
 {
@@ -53,25 +70,60 @@ public:
     SDL_Joysticks (QObject* parent = Q_NULLPTR);
     ~SDL_Joysticks();
 
+    int pollingInterval() const;
     QList<QJoystickDevice*> joysticks();
+    void setJoystickID (QJoystickDevice* joystick, const int id);
+    void setAxisFilter (QJoystickDevice* joystick,
+                        const QJoystickAxisFilter* filter);
 
 public slots:
     void rumble (const QJoystickRumble& request);
+    void setPollingInterval (const int msecs);
 
 private slots:
-    void update();
-    void configureJoystick (const SDL_Event* event);
+    void releaseDevices();
 
 private:
-    int getDynamicID (int id);
+    friend class SDL_InputThread;
 
-    QJoystickDevice* getJoystick (int id);
+    void processEvents();
+    void handleEvent (const SDL_Event* event);
+    void configureJoystick (const SDL_Event* event);
+    void removeJoystick (const SDL_Event* event);
+    void filterAxisEvent (const SDL_Event* event);
+    void flushAxisEvents();
+
+    QJoystickDevice* getJoystick (SDL_JoystickID id);
     QJoystickPOVEvent getPOVEvent (const SDL_Event* sdl_event);
     QJoystickAxisEvent getAxisEvent (const SDL_Event* sdl_event);
     QJoystickButtonEvent getButtonEvent (const SDL_Event* sdl_event);
 
-    int m_tracker;
-    QList<QJoystickDevice> m_joysticks;
+    /**
+     * Holds the SDL handles opened for an attached joystick and the state
+     * of its axis filter
+     */
+    struct SDL_Device {
+        SDL_Joystick* joystick;
+        SDL_GameController* controller;
+
+        bool filtered;
+        QJoystickAxisFilter filter;
+        QVector<bool> changed;
+        QVector<qreal> values;
+        QVector<qreal> pending;
+    };
+
+    QList<SDL_JoystickID> m_filtered;
+    QList<QJoystickDevice*> m_devices;
+    QList<QJoystickDevice*> m_removed;
+    QHash<SDL_JoystickID, SDL_Device> m_handles;
+    QHash<SDL_JoystickID, QJoystickDevice*> m_registry;
+
+    QMutex m_mutex;
+    QSemaphore m_ready;
+    QAtomicInt m_running;
+    QAtomicInt m_interval;
+    SDL_InputThread* m_thread;
 };
 
 #endif
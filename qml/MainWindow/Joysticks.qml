@@ -85,37 +85,12 @@ Item {
     }
 
     //
-    // Regenerate the UI when a joystick is removed or attached and
-    // update DriverStation joysticks
+    // Regenerate the UI when a joystick is removed or attached, the joystick
+    // values are sent to the DriverStation by the C++ code
     //
     Connections {
         target: QJoysticks
-
-        onCountChanged: {
-            updateControls()
-            DS.resetJoysticks()
-
-            for (var i = 0; i < QJoysticks.count; ++i) {
-                DS.addJoystick (QJoysticks.getNumAxes (i),
-                                           QJoysticks.getNumPOVs (i),
-                                           QJoysticks.getNumButtons (i))
-            }
-        }
-
-        onPovChanged: {
-            var val = QJoysticks.isBlacklisted (currentJoystick) ? 0 : angle
-            DS.setJoystickHat (js, pov, val)
-        }
-
-        onAxisChanged: {
-            var val = QJoysticks.isBlacklisted (currentJoystick) ? 0 : value
-            DS.setJoystickAxis (js, axis, val)
-        }
-
-        onButtonChanged: {
-            var val = QJoysticks.isBlacklisted (currentJoystick) ? false : pressed
-            DS.setJoystickButton (js, button, val)
-        }
+        onCountChanged: updateControls()
     }
 
     Connections {
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2015-2016 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <LibDS.h>
+#include <QJoysticks.h>
+#include <QCoreApplication>
+#include <DriverStation.h>
+
+#include "joysticks.h"
+
+/**
+ * Connects the QJoysticks signals with the LibDS joystick functions
+ */
+Joysticks::Joysticks()
+{
+    m_active = true;
+    m_blacklisted = 0;
+    QJoysticks* joysticks = QJoysticks::getInstance();
+
+    /* Stop updating the LibDS before it is closed (we are created before
+     * the DS is started, so this runs before DriverStation::quitDS()) */
+    connect (qApp, &QCoreApplication::aboutToQuit,
+             this, &Joysticks::stop);
+
+    /* Re-register the joysticks when a device is attached or removed */
+    connect (joysticks, &QJoysticks::countChanged,
+             this,      &Joysticks::registerJoysticks);
+
+    /* Update the LibDS directly from the thread that reads the input */
+    connect (joysticks, &QJoysticks::POVEvent,
+             this,      &Joysticks::onPOVEvent, Qt::DirectConnection);
+    connect (joysticks, &QJoysticks::axisEvent,
+             this,      &Joysticks::onAxisEvent, Qt::DirectConnection);
+    connect (joysticks, &QJoysticks::buttonEvent,
+             this,      &Joysticks::onButtonEvent, Qt::DirectConnection);
+}
+
+/**
+ * Disconnects the input signals and waits for the input thread to leave
+ * the LibDS, so that no joystick function is called after \c DS_Close()
+ */
+void Joysticks::stop()
+{
+    QJoysticks* joysticks = QJoysticks::getInstance();
+    disconnect (joysticks, &QJoysticks::POVEvent, this, &Joysticks::onPOVEvent);
+    disconnect (joysticks, &QJoysticks::axisEvent, this, &Joysticks::onAxisEvent);
+    disconnect (joysticks, &QJoysticks::buttonEvent, this, &Joysticks::onButtonEvent);
+
+    QMutexLocker locker (&m_mutex);
+    m_active = false;
+}
+
+/**
+ * Registers every joystick of the QJoysticks system with the LibDS, the
+ * blacklisted joysticks are registered too, so that the joystick IDs used
+ * by the LibDS are the same as the ones used by the QJoysticks system
+ */
+void Joysticks::registerJoysticks()
+{
+    QJoysticks* joysticks = QJoysticks::getInstance();
+    DriverStation* ds = DriverStation::getInstance();
+
+    /* Cache the blacklist state for the input thread */
+    int blacklisted = 0;
+    for (int i = 0; i < qMin (joysticks->count(), 32); ++i) {
+        if (joysticks->isBlacklisted (i))
+            blacklisted |= 1 << i;
+    }
+
+    m_blacklisted = blacklisted;
+
+    ds->resetJoysticks();
+    for (int i = 0; i < joysticks->count(); ++i) {
+        ds->addJoystick (joysticks->getNumAxes (i),
+                         joysticks->getNumPOVs (i),
+                         joysticks->getNumButtons (i));
+    }
+}
+
+/**
+ * Updates the POV angle of the joystick that caused the \a event
+ */
+void Joysticks::onPOVEvent (const QJoystickPOVEvent& event)
+{
+    QMutexLocker locker (&m_mutex);
+    if (m_active && !isBlacklisted (event.joystick->id))
+        DS_SetJoystickHat (event.joystick->id, event.pov, event.angle);
+}
+
+/**
+ * Updates the axis value of the joystick that caused the \a event
+ */
+void Joysticks::onAxisEvent (const QJoystickAxisEvent& event)
+{
+    QMutexLocker locker (&m_mutex);
+    if (m_active && !isBlacklisted (event.joystick->id))
+        DS_SetJoystickAxis (event.joystick->id, event.axis,
+                            static_cast<float> (event.value));
+}
+
+/**
+ * Updates the button state of the joystick that caused the \a event
+ */
+void Joysticks::onButtonEvent (const QJoystickButtonEvent& event)
+{
+    QMutexLocker locker (&m_mutex);
+    if (m_active && !isBlacklisted (event.joystick->id))
+        DS_SetJoystickButton (event.joystick->id, event.button, event.pressed);
+}
+
+/**
+ * Returns \c true if the joystick \a js was blacklisted when the joysticks
+ * were registered with the LibDS
+ */
+bool Joysticks::isBlacklisted (const int js) const
+{
+    if (js >= 0 && js < 32)
+        return (m_blacklisted.load() >> js) & 1;
+
+    return true;
+}
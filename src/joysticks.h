@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015-2016 Alex Spataru <alex_spataru@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef _QDS_JOYSTICKS_H
+#define _QDS_JOYSTICKS_H
+
+#include <QMutex>
+#include <QObject>
+#include <QAtomicInt>
+#include <QJoysticks/JoysticksCommon.h>
+
+/**
+ * \brief Feeds the input of the QJoysticks system to the LibDS
+ *
+ * The input signals are handled with direct connections, so that the LibDS
+ * joystick values are updated in the same thread that reads the joysticks,
+ * without going through the QML engine or waiting for the GUI event loop.
+ *
+ * The input thread outlives the LibDS, so the class stops feeding the LibDS
+ * when the application is about to quit (before the LibDS is closed).
+ */
+class Joysticks : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Joysticks();
+
+private slots:
+    void stop();
+    void registerJoysticks();
+    void onPOVEvent (const QJoystickPOVEvent& event);
+    void onAxisEvent (const QJoystickAxisEvent& event);
+    void onButtonEvent (const QJoystickButtonEvent& event);
+
+private:
+    bool isBlacklisted (const int js) const;
+
+    bool m_active;
+    QMutex m_mutex;
+    QAtomicInt m_blacklisted;
+};
+
+#endif
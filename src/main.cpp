@@ -47,6 +47,7 @@
 #include "beeper.h"
 #include "versions.h"
 #include "shortcuts.h"
+#include "joysticks.h"
 #include "utilities.h"
 #include "dashboards.h"
 
@@ -235,6 +236,7 @@ int main (int argc, char* argv[])
     Beeper beeper;
     Utilities utilities;
     Shortcuts shortcuts;
+    Joysticks joysticks;
     Dashboards dashboards;
     QJoysticks* qjoysticks = QJoysticks::getInstance();
     DriverStation* driverstation = DriverStation::getInstance();